@@ -0,0 +1,227 @@
+/*
+// Copyright (c) 2014 Intel Corporation 
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+#include <HwcTrace.h>
+#include <CadenceTracker.h>
+
+namespace android {
+namespace intel {
+
+CadenceTracker::CadenceTracker()
+{
+    reset();
+}
+
+CadenceTracker::~CadenceTracker()
+{
+}
+
+void CadenceTracker::addFrame(nsecs_t timestamp)
+{
+    mTimes[mHead] = timestamp;
+    mHead = (mHead + 1) & (HISTORY_SIZE - 1);
+    if (mCount < HISTORY_SIZE) {
+        mCount++;
+    }
+    mEstimated = false;
+}
+
+void CadenceTracker::reset()
+{
+    memset(mTimes, 0, sizeof(mTimes));
+    mHead = 0;
+    mCount = 0;
+    mEstimated = false;
+    mFrameRate = 0;
+    mJitter = 0;
+    mCadence = CADENCE_UNKNOWN;
+}
+
+uint32_t CadenceTracker::getFrameRate()
+{
+    if (!isActive()) {
+        return 0;
+    }
+    if (!mEstimated) {
+        estimate();
+    }
+    return mFrameRate;
+}
+
+uint32_t CadenceTracker::getJitter()
+{
+    if (!isActive()) {
+        return 0;
+    }
+    if (!mEstimated) {
+        estimate();
+    }
+    return mJitter;
+}
+
+int CadenceTracker::getCadence()
+{
+    if (!isActive()) {
+        return CADENCE_UNKNOWN;
+    }
+    if (!mEstimated) {
+        estimate();
+    }
+    return mCadence;
+}
+
+uint32_t CadenceTracker::getCadenceRate(int cadence)
+{
+    switch (cadence) {
+    case CADENCE_24:
+    case CADENCE_PULLDOWN_32:
+        return 2400;
+    case CADENCE_25:
+        return 2500;
+    case CADENCE_30:
+        return 3000;
+    case CADENCE_50:
+        return 5000;
+    case CADENCE_60:
+        return 6000;
+    default:
+        return 0;
+    }
+}
+
+const char* CadenceTracker::getCadenceName(int cadence)
+{
+    switch (cadence) {
+    case CADENCE_24:
+        return "24 fps";
+    case CADENCE_25:
+        return "25 fps";
+    case CADENCE_30:
+        return "30 fps";
+    case CADENCE_50:
+        return "50 fps";
+    case CADENCE_60:
+        return "60 fps";
+    case CADENCE_PULLDOWN_32:
+        return "3:2 pulldown";
+    default:
+        return "unknown";
+    }
+}
+
+bool CadenceTracker::isActive() const
+{
+    if (mCount == 0) {
+        return false;
+    }
+    nsecs_t last = mTimes[(mHead - 1) & (HISTORY_SIZE - 1)];
+    return systemTime(SYSTEM_TIME_MONOTONIC) - last <= ms2ns(STALE_TIME_MS);
+}
+
+nsecs_t CadenceTracker::getInterval(uint32_t i) const
+{
+    // i-th most recent interval
+    uint32_t newer = (mHead - 1 - i) & (HISTORY_SIZE - 1);
+    uint32_t older = (mHead - 2 - i) & (HISTORY_SIZE - 1);
+    return mTimes[newer] - mTimes[older];
+}
+
+void CadenceTracker::estimate()
+{
+    mEstimated = true;
+    mFrameRate = 0;
+    mJitter = 0;
+    mCadence = CADENCE_UNKNOWN;
+
+    uint32_t intervals = mCount ? mCount - 1 : 0;
+    if (intervals < MIN_INTERVALS) {
+        return;
+    }
+
+    nsecs_t newest = mTimes[(mHead - 1) & (HISTORY_SIZE - 1)];
+    nsecs_t oldest = mTimes[(mHead - mCount) & (HISTORY_SIZE - 1)];
+    nsecs_t mean = (newest - oldest) / intervals;
+    if (mean <= 0) {
+        return;
+    }
+
+    nsecs_t deviation = 0;
+    for (uint32_t i = 0; i < intervals; i++) {
+        nsecs_t d = getInterval(i) - mean;
+        deviation += (d < 0) ? -d : d;
+    }
+    deviation /= intervals;
+
+    mFrameRate = (uint32_t)(seconds_to_nanoseconds(100) / mean);
+    mJitter = (uint32_t)ns2us(deviation);
+    mCadence = matchCadence(mean, deviation);
+    VTRACE("rate %u, jitter %u us, cadence %s",
+           mFrameRate, mJitter, getCadenceName(mCadence));
+}
+
+int CadenceTracker::matchCadence(nsecs_t mean, nsecs_t jitter) const
+{
+    if (isPulldown(mean)) {
+        return CADENCE_PULLDOWN_32;
+    }
+
+    // nominal cadences need steady intervals
+    if (jitter * 100 > mean * INTERVAL_TOLERANCE) {
+        return CADENCE_UNKNOWN;
+    }
+
+    for (int cadence = CADENCE_24; cadence <= CADENCE_60; cadence++) {
+        uint32_t nominal = getCadenceRate(cadence);
+        uint32_t diff = (mFrameRate > nominal) ?
+            mFrameRate - nominal : nominal - mFrameRate;
+        if (diff * 100 <= nominal * RATE_TOLERANCE) {
+            return cadence;
+        }
+    }
+    return CADENCE_UNKNOWN;
+}
+
+bool CadenceTracker::isPulldown(nsecs_t mean) const
+{
+    uint32_t nominal = getCadenceRate(CADENCE_PULLDOWN_32);
+    uint32_t diff = (mFrameRate > nominal) ?
+        mFrameRate - nominal : nominal - mFrameRate;
+    if (diff * 100 > nominal * RATE_TOLERANCE) {
+        return false;
+    }
+
+    // frames alternate between 3 and 2 refreshes, 6/5 and 4/5 of the mean
+    nsecs_t tolerance = mean * INTERVAL_TOLERANCE / 100;
+    nsecs_t longInterval = mean * 6 / 5;
+    nsecs_t shortInterval = mean * 4 / 5;
+    bool previousLong = false;
+    uint32_t intervals = mCount - 1;
+    for (uint32_t i = 0; i < intervals; i++) {
+        nsecs_t d = getInterval(i);
+        bool isLong = d >= longInterval - tolerance && d <= longInterval + tolerance;
+        bool isShort = d >= shortInterval - tolerance && d <= shortInterval + tolerance;
+        if (!isLong && !isShort) {
+            return false;
+        }
+        if (i > 0 && isLong == previousLong) {
+            return false;
+        }
+        previousLong = isLong;
+    }
+    return true;
+}
+
+} // namespace intel
+} // namespace android
@@ -0,0 +1,97 @@
+/*
+// Copyright (c) 2014 Intel Corporation 
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+#ifndef CADENCE_TRACKER_H
+#define CADENCE_TRACKER_H
+
+#include <utils/Timers.h>
+
+namespace android {
+namespace intel {
+
+// Content cadence of a layer. Times of content updates are kept in a fixed
+// size ring so adding a frame is O(1); frame rate, jitter and cadence are
+// estimated from the whole history when queried and kept until the next
+// frame is added.
+class CadenceTracker {
+public:
+    enum {
+        // must be a power of 2
+        HISTORY_SIZE = 64,
+        // intervals needed before anything is estimated
+        MIN_INTERVALS = 8,
+    };
+
+    enum {
+        CADENCE_UNKNOWN = 0,
+        CADENCE_24,
+        CADENCE_25,
+        CADENCE_30,
+        CADENCE_50,
+        CADENCE_60,
+        // 24 fps content repeated for 3 and 2 refreshes of a 60Hz display
+        CADENCE_PULLDOWN_32,
+    };
+
+public:
+    CadenceTracker();
+    ~CadenceTracker();
+
+public:
+    void addFrame(nsecs_t timestamp);
+    void reset();
+
+    // frame rate in 1/100 fps, 0 if unknown or the content stopped
+    uint32_t getFrameRate();
+    // mean deviation of the frame interval in microseconds
+    uint32_t getJitter();
+    int getCadence();
+    // nominal frame rate of a cadence, 0 for CADENCE_UNKNOWN
+    static uint32_t getCadenceRate(int cadence);
+    static const char* getCadenceName(int cadence);
+
+private:
+    bool isActive() const;
+    void estimate();
+    nsecs_t getInterval(uint32_t i) const;
+    int matchCadence(nsecs_t mean, nsecs_t jitter) const;
+    bool isPulldown(nsecs_t mean) const;
+
+private:
+    enum {
+        // content not updated for this long has no frame rate
+        STALE_TIME_MS = 500,
+        // tolerance of nominal rates and interval patterns in percent
+        RATE_TOLERANCE = 3,
+        INTERVAL_TOLERANCE = 15,
+    };
+
+    nsecs_t mTimes[HISTORY_SIZE];
+    // index of the next entry to write and number of valid entries
+    uint32_t mHead;
+    uint32_t mCount;
+
+    // estimates of the current history
+    bool mEstimated;
+    uint32_t mFrameRate;
+    uint32_t mJitter;
+    int mCadence;
+};
+
+} // namespace intel
+} // namespace android
+
+
+#endif /* CADENCE_TRACKER_H */
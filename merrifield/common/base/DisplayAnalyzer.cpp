@@ -22,7 +22,6 @@
 #include <Hwcomposer.h>
 #include <DisplayAnalyzer.h>
 #include <cutils/properties.h>
-#include <GraphicBuffer.h>
 #include <ExternalDevice.h>
 #include <VirtualDevice.h>
 
@@ -41,6 +40,12 @@ DisplayAnalyzer::DisplayAnalyzer()
       mProtectedVideoSession(false),
       mCachedNumDisplays(0),
       mCachedDisplays(0),
+      mForcedGeometry(0),
+      mPausedVideo(0),
+      mRefreshPolicyEnabled(true),
+      mContentRate(0),
+      mContentCadence(0),
+      mContentRateUpdated(false),
       mPendingEvents(),
       mEventMutex(),
       mEventHandledCondition()
@@ -58,6 +63,17 @@ bool DisplayAnalyzer::initialize()
     if (property_get("hwc.video.extmode.enable", prop, "1") > 0) {
         mVideoExtModeEnabled = atoi(prop) ? true : false;
     }
+    if (property_get("hwc.refresh.policy", prop, "1") > 0) {
+        mRefreshPolicyEnabled = atoi(prop) ? true : false;
+    }
+    if (property_get("hwc.refresh.hysteresis", prop, NULL) > 0 &&
+        atoi(prop) > 0) {
+        mRefreshPolicy.setHysteresis(atoi(prop));
+    }
+    // lowering the rate of an idle UI resyncs the TV twice, opt in only
+    if (property_get("hwc.refresh.static", prop, "0") > 0) {
+        mRefreshPolicy.setStaticLowering(atoi(prop) ? true : false);
+    }
     mVideoExtModeEligible = false;
     mVideoExtModeActive = false;
     mBlankDevice = false;
@@ -67,6 +83,12 @@ bool DisplayAnalyzer::initialize()
     mProtectedVideoSession = false;
     mCachedNumDisplays = 0;
     mCachedDisplays = 0;
+    mForcedGeometry = 0;
+    mPausedVideo = 0;
+    mRefreshPolicy.reset();
+    mContentRate = 0;
+    mContentCadence = 0;
+    mContentRateUpdated = false;
     mPendingEvents.clear();
     mVideoStateMap.clear();
     mInitialized = true;
@@ -87,9 +109,14 @@ void DisplayAnalyzer::analyzeContents(
     // cache and use them only in this context during analysis
     mCachedNumDisplays = numDisplays;
     mCachedDisplays = displays;
+    mForcedGeometry = 0;
 
     handlePendingEvents();
 
+    if (mRefreshPolicyEnabled) {
+        checkRefreshRate();
+    }
+
     if (mVideoExtModeEnabled) {
         handleVideoExtMode();
     }
@@ -249,19 +276,12 @@ bool DisplayAnalyzer::isVideoExtModeEnabled()
 
 bool DisplayAnalyzer::isVideoLayer(hwc_layer_1_t &layer)
 {
-    bool ret = false;
     BufferManager *bm = Hwcomposer::getInstance().getBufferManager();
-    if (!layer.handle) {
+    BufferMetadata meta;
+    if (!layer.handle || !bm->getMetadata(layer.handle, meta)) {
         return false;
     }
-    DataBuffer *buffer = bm->lockDataBuffer(layer.handle);
-     if (!buffer) {
-         ETRACE("failed to get buffer");
-     } else {
-        ret = DisplayQuery::isVideoFormat(buffer->getFormat());
-        bm->unlockDataBuffer(buffer);
-    }
-    return ret;
+    return DisplayQuery::isVideoFormat(meta.format);
 }
 
 bool DisplayAnalyzer::isVideoFullScreen(int device, hwc_layer_1_t &layer)
@@ -430,6 +450,12 @@ void DisplayAnalyzer::handlePendingEvents()
     case VIDEO_CHECK_EVENT:
         handleVideoCheckEvent();
         break;
+    case PLANE_ALLOCATION_EVENT:
+        handlePlaneAllocationEvent();
+        break;
+    case PLANE_REASSIGN_EVENT:
+        handlePlaneReassignEvent(e.nValue);
+        break;
     }
 }
 
@@ -459,6 +485,7 @@ void DisplayAnalyzer::handleHotplugEvent(bool connected)
                 if (hz > 0 && info.frameRate > 0 && hz != info.frameRate) {
                     ITRACE("Old Hz %d, new one %d", hz, info.frameRate);
                     dev->setRefreshRate(info.frameRate);
+                    mRefreshPolicy.reset();
                 } else
                     WTRACE("Old Hz %d is invalid, %d", hz, info.frameRate);
             }
@@ -472,6 +499,47 @@ void DisplayAnalyzer::handleHotplugEvent(bool connected)
     }
 }
 
+void DisplayAnalyzer::postPlaneAllocationEvent()
+{
+    Event e;
+    e.type = PLANE_ALLOCATION_EVENT;
+    e.nValue = 0;
+    postEvent(e);
+}
+
+void DisplayAnalyzer::handlePlaneAllocationEvent()
+{
+    // shared planes are re-balanced, force geometry changed in the physical
+    // devices so that planes are assigned again
+    for (int i = 0; i < (int)mCachedNumDisplays; i++) {
+        if (i == IDisplayDevice::DEVICE_VIRTUAL) {
+            continue;
+        }
+        if (mCachedDisplays[i]) {
+            forceGeometryChanged(i);
+        }
+    }
+}
+
+void DisplayAnalyzer::postPlaneReassignEvent(int device)
+{
+    Event e;
+    e.type = PLANE_REASSIGN_EVENT;
+    e.nValue = device;
+    postEvent(e);
+}
+
+void DisplayAnalyzer::handlePlaneReassignEvent(int device)
+{
+    if (device < 0 || device >= (int)mCachedNumDisplays ||
+        device == IDisplayDevice::DEVICE_VIRTUAL) {
+        return;
+    }
+    if (mCachedDisplays[device]) {
+        forceGeometryChanged(device);
+    }
+}
+
 void DisplayAnalyzer::handleBlankEvent(bool blank)
 {
     mBlankDevice = blank;
@@ -481,7 +549,7 @@ void DisplayAnalyzer::handleBlankEvent(bool blank)
             continue;
         }
         if (mCachedDisplays[i]) {
-            mCachedDisplays[i]->flags |= HWC_GEOMETRY_CHANGED;
+            forceGeometryChanged(i);
         }
     }
     blankSecondaryDevice();
@@ -520,6 +588,8 @@ void DisplayAnalyzer::handleTimingEvent()
     }
 
     dev->setRefreshRate(hz);
+    // the policy reads the active mode again once the session is over
+    mRefreshPolicy.reset();
 }
 
 void DisplayAnalyzer::handleVideoEvent(int instanceID, int state)
@@ -680,9 +750,11 @@ void DisplayAnalyzer::handleIdleEntryEvent(int count)
         return;
     }
 
-    // stop idle entry if video playback is active
+    // stop idle entry if video playback is active, a paused video does
+    // not update the screen and does not keep it out of idle
     // TODO: remove this check for Annidale
-    if (mVideoStateMap.size() > 0) {
+    if (mVideoStateMap.size() > 0 &&
+        !(mPausedVideo & (1 << IDisplayDevice::DEVICE_PRIMARY))) {
         ITRACE("Ignoring idle entry as video session is active.");
         setCompositionType(0, HWC_FRAMEBUFFER, true);
         return;
@@ -842,19 +914,12 @@ bool DisplayAnalyzer::hasProtectedLayer()
 
 bool DisplayAnalyzer::isProtectedLayer(hwc_layer_1_t &layer)
 {
-    if (!layer.handle) {
-        return false;
-    }
-    bool ret = false;
     BufferManager *bm = Hwcomposer::getInstance().getBufferManager();
-    DataBuffer *buffer = bm->lockDataBuffer(layer.handle);
-    if (!buffer) {
-        ETRACE("failed to get buffer");
-    } else {
-        ret = GraphicBuffer::isProtectedBuffer((GraphicBuffer*)buffer);
-        bm->unlockDataBuffer(buffer);
+    BufferMetadata meta;
+    if (!layer.handle || !bm->getMetadata(layer.handle, meta)) {
+        return false;
     }
-    return ret;
+    return meta.isProtected;
 }
 
 bool DisplayAnalyzer::ignoreVideoSkipFlag()
@@ -880,12 +945,114 @@ void DisplayAnalyzer::setCompositionType(int device, int type, bool reset)
 
     // don't need to set geometry changed if layers are just needed to be marked
     if (reset) {
-        content->flags |= HWC_GEOMETRY_CHANGED;
+        forceGeometryChanged(device);
     }
 
     setCompositionType(content, type);
 }
 
+void DisplayAnalyzer::forceGeometryChanged(int device)
+{
+    hwc_display_contents_1_t *content = mCachedDisplays[device];
+    if (content == NULL) {
+        return;
+    }
+
+    content->flags |= HWC_GEOMETRY_CHANGED;
+    mForcedGeometry |= (1 << device);
+}
+
+bool DisplayAnalyzer::isGeometryForced(int device)
+{
+    if (device < 0 || device >= (int)mCachedNumDisplays) {
+        return false;
+    }
+    return (mForcedGeometry & (1 << device)) ? true : false;
+}
+
+void DisplayAnalyzer::setVideoPaused(int device, bool paused)
+{
+    if (device < 0 || device >= IDisplayDevice::DEVICE_COUNT) {
+        return;
+    }
+
+    if (paused) {
+        mPausedVideo |= (1 << device);
+    } else {
+        mPausedVideo &= ~(1 << device);
+    }
+}
+
+void DisplayAnalyzer::setContentRate(int device, uint32_t rate, int cadence)
+{
+    if (device != IDisplayDevice::DEVICE_EXTERNAL) {
+        return;
+    }
+    mContentRate = rate;
+    mContentCadence = cadence;
+    mContentRateUpdated = true;
+}
+
+void DisplayAnalyzer::checkRefreshRate()
+{
+    // Drm::setRefreshRate only switches modes of the external display
+    Hwcomposer *hwc = &Hwcomposer::getInstance();
+    ExternalDevice *dev = NULL;
+    dev = (ExternalDevice *)hwc->getDisplayDevice(IDisplayDevice::DEVICE_EXTERNAL);
+    if (!dev || !dev->isConnected()) {
+        mRefreshPolicy.reset();
+        mContentRateUpdated = false;
+        return;
+    }
+
+    // rate reported by MDS for a video session takes precedence, the mode
+    // it sets is read again when the policy takes over
+    if (mVideoStateMap.size() > 0 ||
+        hwc->getMultiDisplayObserver()->isExternalDeviceTimingFixed()) {
+        mRefreshPolicy.reset();
+        return;
+    }
+
+    // refresh rates at the current resolution and the active one are read
+    // again when the content rate changes, the policy runs on every frame
+    // to wait out its hysteresis
+    if (mContentRateUpdated || !mRefreshPolicy.hasRates()) {
+        mContentRateUpdated = false;
+        Drm *drm = hwc->getDrm();
+        drmModeModeInfo current;
+        int count = 0;
+        drmModeModeInfoPtr modes =
+            drm->detectAllConfigs(IDisplayDevice::DEVICE_EXTERNAL, &count);
+        if (!modes || !drm->getModeInfo(IDisplayDevice::DEVICE_EXTERNAL, current)) {
+            return;
+        }
+
+        uint32_t rates[RefreshRatePolicy::MAX_RATES];
+        int rateCount = 0;
+        for (int i = 0; i < count && rateCount < RefreshRatePolicy::MAX_RATES; i++) {
+            if (modes[i].hdisplay == current.hdisplay &&
+                modes[i].vdisplay == current.vdisplay) {
+                rates[rateCount++] = modes[i].vrefresh;
+            }
+        }
+        mRefreshPolicy.setRates(rates, rateCount, current.vrefresh);
+    }
+
+    uint32_t hz;
+    if (mRefreshPolicy.update(mContentRate, mContentCadence,
+                              systemTime(SYSTEM_TIME_MONOTONIC), hz)) {
+        // ExternalDevice restarts HDCP around the mode change
+        dev->setRefreshRate(hz);
+    }
+}
+
+void DisplayAnalyzer::dump(Dump& d)
+{
+    if (mRefreshPolicyEnabled) {
+        mRefreshPolicy.dump(d);
+    }
+}
+
 int DisplayAnalyzer::getFirstVideoInstanceSessionID() {
     if (mVideoStateMap.size() >= 1) {
         return mVideoStateMap.keyAt(0);
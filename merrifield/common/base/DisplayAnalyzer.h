@@ -18,6 +18,8 @@
 
 #include <utils/threads.h>
 #include <utils/Vector.h>
+#include <Dump.h>
+#include <RefreshRatePolicy.h>
 
 
 namespace android {
@@ -45,10 +47,25 @@ public:
     void postVideoEvent(int instances, int instanceID, bool preparing, bool playing);
     void postBlankEvent(bool blank);
     void postIdleEntryEvent();
+    void postPlaneAllocationEvent();
+    // planes of the device are assigned again in the next frame, other
+    // devices keep theirs
+    void postPlaneReassignEvent(int device);
     bool isPresentationLayer(hwc_layer_1_t &layer);
     bool isProtectedLayer(hwc_layer_1_t &layer);
     bool ignoreVideoSkipFlag();
     int  getFirstVideoInstanceSessionID();
+    // true if geometry change of the device is forced by the analyzer in
+    // the current frame, such a change must always re-assign planes
+    bool isGeometryForced(int device);
+    // video layers of the device keep presenting repeated frames, called
+    // by the layer list of the device when the state changes
+    void setVideoPaused(int device, bool paused);
+    // measured content rate of the device in 1/100 fps and its cadence,
+    // drives the refresh rate of the external display
+    void setContentRate(int device, uint32_t rate, int cadence);
+    // dump interface
+    void dump(Dump& d);
 
 private:
     enum DisplayEventType {
@@ -61,6 +78,8 @@ private:
         IDLE_ENTRY_EVENT,
         IDLE_EXIT_EVENT,
         VIDEO_CHECK_EVENT,
+        PLANE_ALLOCATION_EVENT,
+        PLANE_REASSIGN_EVENT,
     };
 
     struct Event {
@@ -89,6 +108,9 @@ private:
     void handleIdleEntryEvent(int count);
     void handleIdleExitEvent();
     void handleVideoCheckEvent();
+    void handlePlaneAllocationEvent();
+    void handlePlaneReassignEvent(int device);
+    void checkRefreshRate();
 
     void blankSecondaryDevice();
     void handleVideoExtMode();
@@ -98,6 +120,7 @@ private:
     bool hasProtectedLayer();
     inline void setCompositionType(hwc_display_contents_1_t *content, int type);
     inline void setCompositionType(int device, int type, bool reset);
+    inline void forceGeometryChanged(int device);
 
 private:
     // Video playback state, must match defintion in Multi Display Service
@@ -132,6 +155,16 @@ private:
     KeyedVector<int, int> mVideoStateMap;
     int mCachedNumDisplays;
     hwc_display_contents_1_t** mCachedDisplays;
+    // bitmap of devices with geometry change forced in the current frame
+    uint32_t mForcedGeometry;
+    // bitmap of devices whose video layers are paused
+    uint32_t mPausedVideo;
+    // content driven refresh rate of the external display
+    bool mRefreshPolicyEnabled;
+    RefreshRatePolicy mRefreshPolicy;
+    uint32_t mContentRate;
+    int mContentCadence;
+    bool mContentRateUpdated;
     Vector<Event> mPendingEvents;
     Mutex mEventMutex;
     Condition mEventHandledCondition;
@@ -17,10 +17,10 @@
 #include <Drm.h>
 #include <HwcLayer.h>
 #include <Hwcomposer.h>
-#include <GraphicBuffer.h>
 #include <IDisplayDevice.h>
 #include <DisplayQuery.h>
 #include <PlaneCapabilities.h>
+#include <RectClip.h>
 #include <cutils/properties.h>
 
 
@@ -59,6 +59,7 @@ HwcLayer::HwcLayer(int index, hwc_layer_1_t *layer)
       mDevice(0),
       mLayer(layer),
       mPlane(0),
+      mLastPlane(0),
       mFormat(DataBuffer::FORMAT_INVALID),
       mWidth(0),
       mHeight(0),
@@ -68,15 +69,31 @@ HwcLayer::HwcLayer(int index, hwc_layer_1_t *layer)
       mType(LAYER_FB),
       mPriority(0),
       mTransform(0),
+      mBpp(0),
+      mUpdateRate(LAYER_UPDATE_RATE_ONE),
+      mBandwidth(0),
       mStaticCount(0),
-      mUpdated(false)
+      mUpdated(false),
+      mHistoryFrozen(false),
+      mCacheHandle(0),
+      mClipped(false),
+      mNextVerdict(0),
+      mBlending(HWC_BLENDING_NONE),
+      mPlaneAlpha(0),
+      mEligibleFrames(LAYER_ELIGIBLE_FRAMES_MAX),
+      mTransitions(0),
+      mHeldBack(false),
+      mOnPlane(false)
 {
+    memset(mVerdicts, 0, sizeof(mVerdicts));
     memset(&mSourceCropf, 0, sizeof(mSourceCropf));
     memset(&mDisplayFrame, 0, sizeof(mDisplayFrame));
     memset(&mStride, 0, sizeof(mStride));
+    memset(&mBounds, 0, sizeof(mBounds));
 
     mPlaneCandidate = false;
     setupAttributes();
+    clipToBounds();
 
 #ifdef HWC_TRACE_FPS
     mTraceFps = false;
@@ -84,12 +101,6 @@ HwcLayer::HwcLayer(int index, hwc_layer_1_t *layer)
     if (property_get("debug.hwc.fps_trace.enable", prop, "0") > 0) {
         mTraceFps = atoi(prop);
     }
-    mLastHandle = NULL;
-
-    if (mTraceFps) {
-        // holding up to 6 seconds of samples at 60Hz
-        mFrames.setCapacity(6 * 60);
-    }
 #endif
 }
 
@@ -101,10 +112,32 @@ HwcLayer::~HwcLayer()
 
     mLayer = NULL;
     mPlane = NULL;
+}
 
-#ifdef HWC_TRACE_FPS
-    mFrames.clear();
-#endif
+void HwcLayer::reset(int index, hwc_layer_1_t *layer)
+{
+    if (mPlane) {
+        WTRACE("plane is still attached to layer %d", mIndex);
+    }
+
+    mIndex = index;
+    mZOrder = index + 1;
+    mDevice = 0;
+    mType = LAYER_FB;
+    mPlaneCandidate = false;
+    mHeldBack = false;
+    mCacheHandle = 0;
+
+    if (layer->handle != mHandle) {
+        // matched by position only, buffer attributes need to be reloaded
+        mFormat = DataBuffer::FORMAT_INVALID;
+        mPriority = 0;
+        invalidateVerdicts();
+    }
+
+    mLayer = layer;
+    setupAttributes();
+    clipToBounds();
 }
 
 bool HwcLayer::attachPlane(DisplayPlane* plane, int device)
@@ -123,6 +156,7 @@ bool HwcLayer::attachPlane(DisplayPlane* plane, int device)
     //plane->setZOrder(mIndex);
     plane->assignToDevice(device);
     mPlane = plane;
+    mLastPlane = plane;
     return true;
 }
 
@@ -238,11 +272,66 @@ hwc_layer_1_t* HwcLayer::getLayer() const
     return mLayer;
 }
 
+const hwc_rect_t& HwcLayer::getDisplayFrame() const
+{
+    return mDisplayFrame;
+}
+
+void HwcLayer::setDisplayBounds(const hwc_rect_t& bounds)
+{
+    if (mBounds.left != bounds.left || mBounds.top != bounds.top ||
+        mBounds.right != bounds.right || mBounds.bottom != bounds.bottom) {
+        mBounds = bounds;
+        invalidateVerdicts();
+    }
+    clipToBounds();
+}
+
+const hwc_rect_t& HwcLayer::getClippedFrame() const
+{
+    return mClippedFrame;
+}
+
+const hwc_frect_t& HwcLayer::getClippedCrop() const
+{
+    return mClippedCrop;
+}
+
+bool HwcLayer::isClipped() const
+{
+    return mClipped;
+}
+
+void HwcLayer::setCacheBuffer(buffer_handle_t handle)
+{
+    mCacheHandle = handle;
+}
+
+buffer_handle_t HwcLayer::getCacheBuffer() const
+{
+    return mCacheHandle;
+}
+
+CadenceTracker& HwcLayer::getCadence()
+{
+    return mCadence;
+}
+
+bool HwcLayer::getVideoPayload(buffer_handle_t& khandle, int64_t& timestamp) const
+{
+    return mVideoActivity.getPayload(khandle, timestamp);
+}
+
 DisplayPlane* HwcLayer::getPlane() const
 {
     return mPlane;
 }
 
+DisplayPlane* HwcLayer::getLastPlane() const
+{
+    return mLastPlane;
+}
+
 void HwcLayer::setPriority(uint32_t priority)
 {
     mPriority = priority;
@@ -253,47 +342,132 @@ uint32_t HwcLayer::getPriority() const
     return mPriority;
 }
 
+uint32_t HwcLayer::getBpp() const
+{
+    return mBpp;
+}
+
+uint32_t HwcLayer::getBandwidth() const
+{
+    return mBandwidth;
+}
+
+uint32_t HwcLayer::getUpdateRate() const
+{
+    return mUpdateRate;
+}
+
+void HwcLayer::setEligible(bool eligible)
+{
+    if (!eligible) {
+        mEligibleFrames = 0;
+    } else if (mEligibleFrames < LAYER_ELIGIBLE_FRAMES_MAX) {
+        mEligibleFrames++;
+    }
+}
+
+uint32_t HwcLayer::getEligibleFrames() const
+{
+    return mEligibleFrames;
+}
+
+void HwcLayer::setHeldBack(bool held)
+{
+    mHeldBack = held;
+}
+
+bool HwcLayer::isHeldBack() const
+{
+    return mHeldBack;
+}
+
+uint32_t HwcLayer::getTransitions() const
+{
+    return mTransitions;
+}
+
+int HwcLayer::getVerdict(int planeType) const
+{
+    if (planeType < 0 || planeType >= DisplayPlane::PLANE_MAX || mHandle == 0) {
+        return VERDICT_UNKNOWN;
+    }
+
+    for (int i = 0; i < VERDICT_CACHE_SIZE; i++) {
+        if (mVerdicts[i].handle == mHandle) {
+            return mVerdicts[i].verdict[planeType];
+        }
+    }
+    return VERDICT_UNKNOWN;
+}
+
+void HwcLayer::setVerdict(int planeType, bool supported)
+{
+    if (planeType < 0 || planeType >= DisplayPlane::PLANE_MAX || mHandle == 0) {
+        return;
+    }
+
+    // buffer attributes are not loaded yet
+    if (mFormat == DataBuffer::FORMAT_INVALID) {
+        return;
+    }
+
+    Verdict *entry = NULL;
+    for (int i = 0; i < VERDICT_CACHE_SIZE; i++) {
+        if (mVerdicts[i].handle == mHandle) {
+            entry = &mVerdicts[i];
+            break;
+        }
+    }
+
+    if (entry == NULL) {
+        // replace the oldest buffer
+        entry = &mVerdicts[mNextVerdict];
+        mNextVerdict = (mNextVerdict + 1) % VERDICT_CACHE_SIZE;
+        memset(entry, 0, sizeof(Verdict));
+        entry->handle = mHandle;
+    }
+
+    entry->verdict[planeType] = supported ? VERDICT_SUPPORTED : VERDICT_UNSUPPORTED;
+}
+
+void HwcLayer::invalidateVerdicts()
+{
+    memset(mVerdicts, 0, sizeof(mVerdicts));
+    mNextVerdict = 0;
+}
+
 bool HwcLayer::update(hwc_layer_1_t *layer)
 {
     // update layer
     mLayer = layer;
     setupAttributes();
+    clipToBounds();
 
 #ifdef HWC_TRACE_FPS
     if (mTraceFps && mLayer && mLayer->compositionType != HWC_FRAMEBUFFER_TARGET ) {
-        // 1 second = 1000000000 nano seconds
-        uint64_t now = systemTime(CLOCK_MONOTONIC);
-        if (mLastHandle != mHandle) {
-            mLastHandle = mHandle;
-            mFrames.push(now);
-        }
-        // calculate fps in 5-second time window
-        int frames = mFrames.size();
-        while (frames && now - mFrames[0] > 5000000000LL) {
-            mFrames.removeItemsAt(0);
-            frames--;
-        }
-        double fps = 0;
-        if (frames > 1) {
-            fps = frames * 1000000000.0/ (now - mFrames[0]);
-        }
-        ITRACE("fps of layer %d is %.1f", mIndex, fps);
+        uint32_t fps = mCadence.getFrameRate();
+        ITRACE("fps of layer %d is %u.%02u", mIndex, fps / 100, fps % 100);
     }
 #endif
 
     // if not a FB layer & a plane was attached update plane's data buffer
     if (mPlane) {
-        mPlane->setPosition(layer->displayFrame.left,
-                            layer->displayFrame.top,
-                            layer->displayFrame.right - layer->displayFrame.left,
-                            layer->displayFrame.bottom - layer->displayFrame.top);
-        mPlane->setSourceCrop(layer->sourceCropf.left,
-                              layer->sourceCropf.top,
-                              layer->sourceCropf.right - layer->sourceCropf.left,
-                              layer->sourceCropf.bottom - layer->sourceCropf.top);
+        buffer_handle_t handle = mCacheHandle ? mCacheHandle : layer->handle;
+        // cursor plane can be positioned partially off screen
+        bool cursor = mPlane->getType() == DisplayPlane::PLANE_CURSOR;
+        const hwc_rect_t& frame = cursor ? layer->displayFrame : mClippedFrame;
+        const hwc_frect_t& crop = cursor ? layer->sourceCropf : mClippedCrop;
+        mPlane->setPosition(frame.left,
+                            frame.top,
+                            frame.right - frame.left,
+                            frame.bottom - frame.top);
+        mPlane->setSourceCrop(crop.left,
+                              crop.top,
+                              crop.right - crop.left,
+                              crop.bottom - crop.top);
         mPlane->setTransform(layer->transform);
         mPlane->setPlaneAlpha(layer->planeAlpha, layer->blending);
-        bool ret = mPlane->setDataBuffer(layer->handle);
+        bool ret = mPlane->setDataBuffer(handle);
         if (ret == true) {
             return true;
         }
@@ -327,6 +501,16 @@ uint32_t HwcLayer::getStaticCount()
 void HwcLayer::postFlip()
 {
     mUpdated = false;
+
+    // count switches between GPU composition and display planes
+    if (mType != LAYER_FRAMEBUFFER_TARGET && mType != LAYER_SKIPPED) {
+        bool onPlane = (mPlane != NULL);
+        if (onPlane != mOnPlane) {
+            mTransitions++;
+            mOnPlane = onPlane;
+        }
+    }
+
     if (mPlane) {
         mPlane->postFlip();
 
@@ -342,14 +526,25 @@ void HwcLayer::postFlip()
     }
 }
 
-void HwcLayer::setupAttributes()
+void HwcLayer::updateHistory()
 {
+    // a video buffer presented again is only updated by a new decoded frame
+    bool videoUpdated = false;
+    if (DisplayQuery::isVideoFormat(mFormat)) {
+        videoUpdated = !mVideoActivity.isRepeated(mLayer->handle);
+    }
+
+    // content updates feed the cadence history
+    if (mLayer->handle && (mHandle != mLayer->handle || videoUpdated)) {
+        mCadence.addFrame(systemTime(SYSTEM_TIME_MONOTONIC));
+    }
+
     if ((mLayer->flags & HWC_SKIP_LAYER) ||
         mTransform != mLayer->transform ||
         mSourceCropf != mLayer->sourceCropf ||
         mDisplayFrame != mLayer->displayFrame ||
         mHandle != mLayer->handle ||
-        DisplayQuery::isVideoFormat(mFormat)) {
+        videoUpdated) {
         // TODO: same handle does not mean there is always no update
         mUpdated = true;
         mStaticCount = 0;
@@ -359,6 +554,35 @@ void HwcLayer::setupAttributes()
             mStaticCount = LAYER_STATIC_THRESHOLD + 1;
     }
 
+    // moving average of the update rate
+    mUpdateRate -= mUpdateRate >> LAYER_UPDATE_RATE_WEIGHT;
+    if (mUpdated) {
+        mUpdateRate += LAYER_UPDATE_RATE_ONE >> LAYER_UPDATE_RATE_WEIGHT;
+    }
+}
+
+void HwcLayer::freezeHistory(bool frozen)
+{
+    mHistoryFrozen = frozen;
+}
+
+void HwcLayer::setupAttributes()
+{
+    if (!mHistoryFrozen) {
+        updateHistory();
+    }
+
+    // capability verdicts depend on these attributes only
+    if (mTransform != mLayer->transform ||
+        mSourceCropf != mLayer->sourceCropf ||
+        mDisplayFrame != mLayer->displayFrame ||
+        mBlending != mLayer->blending ||
+        mPlaneAlpha != mLayer->planeAlpha) {
+        invalidateVerdicts();
+    }
+    mBlending = mLayer->blending;
+    mPlaneAlpha = mLayer->planeAlpha;
+
     // update handle always as it can become "NULL"
     // if the given layer is not ready
     mTransform = mLayer->transform;
@@ -368,6 +592,7 @@ void HwcLayer::setupAttributes()
 
     if (mFormat != DataBuffer::FORMAT_INVALID) {
         // other attributes have been set.
+        updatePriority();
         return;
     }
 
@@ -382,27 +607,76 @@ void HwcLayer::setupAttributes()
         return;
     }
 
-    DataBuffer *buffer = bm->lockDataBuffer(mLayer->handle);
-     if (!buffer) {
+    BufferMetadata meta;
+    if (!bm->getMetadata(mLayer->handle, meta)) {
          ETRACE("failed to get buffer");
      } else {
-        mFormat = buffer->getFormat();
-        mWidth = buffer->getWidth();
-        mHeight = buffer->getHeight();
-        mStride = buffer->getStride();
-        mPriority = (mSourceCropf.right - mSourceCropf.left) * (mSourceCropf.bottom - mSourceCropf.top);
-        mPriority <<= LAYER_PRIORITY_SIZE_OFFSET;
-        mPriority |= mIndex;
-        GraphicBuffer *gBuffer = (GraphicBuffer*)buffer;
-        mUsage = gBuffer->getUsage();
-        mIsProtected = GraphicBuffer::isProtectedBuffer((GraphicBuffer*)buffer);
+        mFormat = meta.format;
+        mWidth = meta.width;
+        mHeight = meta.height;
+        mStride = meta.stride;
+        mUsage = meta.usage;
+        mBpp = meta.bpp;
+        if (mBpp == 0) {
+            mBpp = DisplayQuery::isVideoFormat(mFormat) ? 12 : 32;
+        }
+        mIsProtected = meta.isProtected;
         if (mIsProtected) {
-            mPriority |= LAYER_PRIORITY_PROTECTED;
-        } else if (PlaneCapabilities::isFormatSupported(DisplayPlane::PLANE_OVERLAY, this)) {
-            mPriority |= LAYER_PRIORITY_OVERLAY;
+            mPriority = LAYER_PRIORITY_PROTECTED;
+        } else if (PlaneCapabilities::isFormatSupported(DisplayPlane::PLANE_OVERLAY, this) &&
+                   mFormat != HAL_PIXEL_FORMAT_BGRA_8888 &&
+                   mFormat != HAL_PIXEL_FORMAT_BGRX_8888) {
+            // RGB layers fit overlay too but rank below YUV content
+            mPriority = LAYER_PRIORITY_OVERLAY;
         }
-        bm->unlockDataBuffer(buffer);
+        updatePriority();
+    }
+}
+
+void HwcLayer::clipToBounds()
+{
+    mClippedFrame = mDisplayFrame;
+    mClippedCrop = mSourceCropf;
+    mClipped = false;
+
+    // bounds are not known, e.g. virtual display
+    if (mBounds.right <= mBounds.left || mBounds.bottom <= mBounds.top) {
+        return;
+    }
+
+    if (!RectClip::isClipped(mDisplayFrame, mBounds)) {
+        return;
+    }
+
+    // keep chroma sampling of YUV buffers intact
+    int alignment = DisplayQuery::isVideoFormat(mFormat) ? 2 : 1;
+    if (!RectClip::clip(mDisplayFrame, mSourceCropf, mTransform, mBounds,
+                        alignment, mClippedFrame, mClippedCrop)) {
+        // nothing visible, leave an empty frame behind
+        mClippedFrame.right = mClippedFrame.left;
+        mClippedFrame.bottom = mClippedFrame.top;
+    }
+    mClipped = true;
+}
+
+void HwcLayer::updatePriority()
+{
+    // rank layers by the memory bandwidth saved per frame if the layer is
+    // scanned out by a plane: crop area x bytes per pixel x update rate.
+    uint64_t area = (uint64_t)(mSourceCropf.right - mSourceCropf.left) *
+                    (uint64_t)(mSourceCropf.bottom - mSourceCropf.top);
+    uint32_t rate = mUpdateRate > LAYER_UPDATE_RATE_MIN ? mUpdateRate : LAYER_UPDATE_RATE_MIN;
+    uint64_t bandwidth = ((area * mBpp) >> 3) * rate / LAYER_UPDATE_RATE_ONE;
+    mBandwidth = (bandwidth > 0xFFFFFFFFULL) ? 0xFFFFFFFF : (uint32_t)bandwidth;
+
+    uint32_t units = mBandwidth >> LAYER_PRIORITY_BANDWIDTH_SHIFT;
+    if (units > LAYER_PRIORITY_BANDWIDTH_MAX) {
+        units = LAYER_PRIORITY_BANDWIDTH_MAX;
     }
+    // keep the protected/overlay class bits set when the buffer was locked
+    mPriority &= LAYER_PRIORITY_CLASS_MASK;
+    mPriority |= units << LAYER_PRIORITY_SIZE_OFFSET;
+    mPriority |= (mIndex & ((1 << LAYER_PRIORITY_SIZE_OFFSET) - 1));
 }
 
 } // namespace intel
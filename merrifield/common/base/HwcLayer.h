@@ -18,6 +18,8 @@
 
 #include <hardware/hwcomposer.h>
 #include <DisplayPlane.h>
+#include <VideoActivityTracker.h>
+#include <CadenceTracker.h>
 #include <utils/Vector.h>
 
 //#define HWC_TRACE_FPS
@@ -55,12 +57,43 @@ public:
     enum {
         LAYER_PRIORITY_OVERLAY = 0x60000000UL,
         LAYER_PRIORITY_PROTECTED = 0x70000000UL,
+        LAYER_PRIORITY_CLASS_MASK = 0xF0000000UL,
         LAYER_PRIORITY_SIZE_OFFSET = 4,
+        // bandwidth is counted in units of 64 bytes per frame
+        LAYER_PRIORITY_BANDWIDTH_SHIFT = 6,
+        LAYER_PRIORITY_BANDWIDTH_MAX = 0x00FFFFFF,
+    };
+
+    enum {
+        // update rate is an 8-bit fixed point moving average, 256 means
+        // the layer is updated in every frame
+        LAYER_UPDATE_RATE_ONE = 256,
+        LAYER_UPDATE_RATE_WEIGHT = 3,
+        // static layers still rank by size among themselves
+        LAYER_UPDATE_RATE_MIN = 8,
+    };
+
+    enum {
+        // eligible frame count saturates here, layers without a history of
+        // being ineligible are treated as settled
+        LAYER_ELIGIBLE_FRAMES_MAX = 1000,
+    };
+
+    enum {
+        // plane capability verdicts
+        VERDICT_UNKNOWN = 0,
+        VERDICT_SUPPORTED,
+        VERDICT_UNSUPPORTED,
+        // verdicts are kept for the buffers of a typical buffer queue
+        VERDICT_CACHE_SIZE = 4,
     };
 public:
     HwcLayer(int index, hwc_layer_1_t *layer);
     virtual ~HwcLayer();
 
+    // rebind to a layer of a new layer list, keeping update history
+    void reset(int index, hwc_layer_1_t *layer);
+
     // plane operations
     bool attachPlane(DisplayPlane *plane, int device);
     DisplayPlane* detachPlane();
@@ -73,6 +106,8 @@ public:
     int getIndex() const;
     int getZOrder() const;
     uint32_t getFormat() const;
+    // bits per pixel of the buffer
+    uint32_t getBpp() const;
     uint32_t getBufferWidth() const;
     uint32_t getBufferHeight() const;
     const stride_t& getBufferStride() const;
@@ -81,12 +116,49 @@ public:
     uint32_t getTransform() const;
     bool isProtected() const;
     hwc_layer_1_t* getLayer() const;
+    // display frame seen at the last update
+    const hwc_rect_t& getDisplayFrame() const;
+
+    // display frame clipped to the display bounds and the source crop
+    // trimmed to match, used to program planes
+    void setDisplayBounds(const hwc_rect_t& bounds);
+    const hwc_rect_t& getClippedFrame() const;
+    const hwc_frect_t& getClippedCrop() const;
+    bool isClipped() const;
+    // buffer scanned out in place of the layer buffer, 0 if none
+    void setCacheBuffer(buffer_handle_t handle);
+    buffer_handle_t getCacheBuffer() const;
+    // frame rate and cadence of the layer content
+    CadenceTracker& getCadence();
+    // decoder surface and media timestamp of the video frame read at the
+    // last update
+    bool getVideoPayload(buffer_handle_t& khandle, int64_t& timestamp) const;
     DisplayPlane* getPlane() const;
+    // plane attached most recently, kept after the plane is detached
+    DisplayPlane* getLastPlane() const;
 
     void setPriority(uint32_t priority);
     uint32_t getPriority() const;
+    // estimated bytes per frame saved by scanning the layer out of a plane
+    uint32_t getBandwidth() const;
+    uint32_t getUpdateRate() const;
+
+    // memoized plane capability check result for the current buffer,
+    // dropped when crop, frame, transform or blending changes
+    int getVerdict(int planeType) const;
+    void setVerdict(int planeType, bool supported);
+
+    // composition path hysteresis
+    void setEligible(bool eligible);
+    uint32_t getEligibleFrames() const;
+    void setHeldBack(bool held);
+    bool isHeldBack() const;
+    uint32_t getTransitions() const;
 
     bool update(hwc_layer_1_t *layer);
+    // the update history of the current frame is already recorded, set
+    // while the same list is loaded again to re-attach planes
+    void freezeHistory(bool frozen);
     void postFlip();
     bool isUpdated();
     uint32_t getStaticCount();
@@ -96,14 +168,19 @@ public:
     bool mPlaneCandidate;
 
 private:
+    void updateHistory();
     void setupAttributes();
+    void clipToBounds();
+    void updatePriority();
+    void invalidateVerdicts();
 
 private:
-    const int mIndex;
+    int mIndex;
     int mZOrder;
     int mDevice;
     hwc_layer_1_t *mLayer;
     DisplayPlane *mPlane;
+    DisplayPlane *mLastPlane;
     uint32_t mFormat;
     uint32_t mWidth;
     uint32_t mHeight;
@@ -114,18 +191,49 @@ private:
     uint32_t mType;
     uint32_t mPriority;
     uint32_t mTransform;
+    uint32_t mBpp;
+    uint32_t mUpdateRate;
+    uint32_t mBandwidth;
 
     // for smart composition
     hwc_frect_t mSourceCropf;
     hwc_rect_t mDisplayFrame;
     uint32_t mStaticCount;
     bool mUpdated;
+    bool mHistoryFrozen;
+    // video payload of a buffer presented again
+    VideoActivityTracker mVideoActivity;
+    // times of content updates
+    CadenceTracker mCadence;
+
+    // flattened copy of static layers owned by the layer list
+    buffer_handle_t mCacheHandle;
+
+    // off-screen clipping
+    hwc_rect_t mBounds;
+    hwc_rect_t mClippedFrame;
+    hwc_frect_t mClippedCrop;
+    bool mClipped;
+
+    // plane capability verdict cache
+    struct Verdict {
+        buffer_handle_t handle;
+        uint8_t verdict[DisplayPlane::PLANE_MAX];
+    };
+    Verdict mVerdicts[VERDICT_CACHE_SIZE];
+    int mNextVerdict;
+    int32_t mBlending;
+    uint8_t mPlaneAlpha;
+
+    // composition path hysteresis
+    uint32_t mEligibleFrames;
+    uint32_t mTransitions;
+    bool mHeldBack;
+    bool mOnPlane;
 
 #ifdef HWC_TRACE_FPS
     // for frame per second trace
     bool mTraceFps;
-    buffer_handle_t mLastHandle;
-    Vector<uint64_t>  mFrames;
 #endif
 };
 
@@ -21,6 +21,8 @@
 #include <IDisplayDevice.h>
 #include <PlaneCapabilities.h>
 #include <DisplayQuery.h>
+#include <VisibleRegion.h>
+#include <cutils/properties.h>
 
 namespace android {
 namespace intel {
@@ -29,21 +31,92 @@ HwcLayerList::HwcLayerList(hwc_display_contents_1_t *list, int disp)
     : mList(list),
       mLayerCount(0),
       mLayers(),
+      mRetiredLayers(),
+      mRetiredTarget(NULL),
       mFBLayers(),
       mStaticLayersIndex(),
       mSpriteCandidates(),
       mOverlayCandidates(),
+      mZOrderMask(0),
       mZOrderConfig(),
       mFrameBufferTarget(NULL),
+      mTargetZOrder(-1),
       mDisplayIndex(disp),
-      mLayerSize(0)
+      mSolverMode(SOLVER_GREEDY),
+      mOpportunisticCursor(false),
+      mCulledLayers(0),
+      mCulledArea(0),
+      mCulledAreaTotal(0),
+      mDamageThreshold(DAMAGE_DEFAULT_THRESHOLD),
+      mDamageFrames(0),
+      mPartialDamageFrames(0),
+      mEmptyDamageFrames(0),
+      mDamageAreaTotal(0),
+      mScreenAreaTotal(0),
+      mRepeatedVideoFrames(0),
+      mVideoPaused(false),
+      mSc2Entries(0),
+      mSc2Exits(0),
+      mSc2FrozenRuns(0),
+      mSc2SavedBytes(0),
+      mSc2Rejected(0),
+      mLayerCacheEnabled(true),
+      mLayerCacheBackoff(0),
+      mVideoPacing(true)
 {
+    mSolution.count = 0;
+    mSc2Solution.count = 0;
+    mSolver.budget = SOLVER_DEFAULT_BUDGET;
+    memset(&mBounds, 0, sizeof(mBounds));
+    memset(&mDamage, 0, sizeof(mDamage));
+
+    char prop[PROPERTY_VALUE_MAX];
+    if (property_get("hwc.plane.solver", prop, "greedy") > 0 &&
+        strcmp(prop, "mincost") == 0) {
+        mSolverMode = SOLVER_MIN_COST;
+    }
+    if (property_get("hwc.plane.solver.budget", prop, "512") > 0 &&
+        atoi(prop) > 0) {
+        mSolver.budget = atoi(prop);
+    }
+
+    memset(mHysteresis, 0, sizeof(mHysteresis));
+    mHysteresis[DisplayPlane::PLANE_SPRITE] = HYSTERESIS_SPRITE_FRAMES;
+    mHysteresis[DisplayPlane::PLANE_OVERLAY] = HYSTERESIS_OVERLAY_FRAMES;
+    mHysteresis[DisplayPlane::PLANE_CURSOR] = HYSTERESIS_CURSOR_FRAMES;
+    if (property_get("hwc.hysteresis.sprite", prop, NULL) > 0) {
+        mHysteresis[DisplayPlane::PLANE_SPRITE] = atoi(prop);
+    }
+    if (property_get("hwc.hysteresis.overlay", prop, NULL) > 0) {
+        mHysteresis[DisplayPlane::PLANE_OVERLAY] = atoi(prop);
+    }
+    if (property_get("hwc.hysteresis.cursor", prop, NULL) > 0) {
+        mHysteresis[DisplayPlane::PLANE_CURSOR] = atoi(prop);
+    }
+    if (property_get("hwc.cursor.opportunistic", prop, "0") > 0) {
+        mOpportunisticCursor = atoi(prop) ? true : false;
+    }
+    if (property_get("hwc.damage.threshold", prop, NULL) > 0 &&
+        atoi(prop) >= 0 && atoi(prop) <= 100) {
+        mDamageThreshold = atoi(prop);
+    }
+    if (property_get("hwc.layercache.enable", prop, "1") > 0) {
+        mLayerCacheEnabled = atoi(prop) ? true : false;
+    }
+    if (property_get("hwc.video.pacing", prop, "1") > 0) {
+        mVideoPacing = atoi(prop) ? true : false;
+    }
+
+    mLayerCache.initialize();
     initialize();
 }
 
 HwcLayerList::~HwcLayerList()
 {
     deinitialize();
+    releaseRetiredLayers();
+    mLayerCache.deinitialize();
+    setVideoPaused(false);
 }
 
 bool HwcLayerList::checkSupported(int planeType, HwcLayer *hwcLayer)
@@ -74,6 +147,21 @@ bool HwcLayerList::checkSupported(int planeType, HwcLayer *hwcLayer)
         return false;
     }
 
+    // capability checks below only depend on the buffer and geometry
+    int verdict = hwcLayer->getVerdict(planeType);
+    if (verdict != HwcLayer::VERDICT_UNKNOWN) {
+        return verdict == HwcLayer::VERDICT_SUPPORTED;
+    }
+
+    valid = checkCapabilities(planeType, hwcLayer);
+    hwcLayer->setVerdict(planeType, valid);
+    return valid;
+}
+
+bool HwcLayerList::checkCapabilities(int planeType, HwcLayer *hwcLayer)
+{
+    bool valid = false;
+
     // check layer transform
     valid = PlaneCapabilities::isTransformSupported(planeType, hwcLayer);
     if (!valid) {
@@ -113,6 +201,24 @@ bool HwcLayerList::checkSupported(int planeType, HwcLayer *hwcLayer)
     return true;
 }
 
+bool HwcLayerList::checkRgbOverlaySupported(HwcLayer *hwcLayer)
+{
+    // sprites scan RGB out for free, overlay only wins when the layer
+    // needs scaling, which sprites cannot do
+    const hwc_frect_t& src = hwcLayer->getClippedCrop();
+    const hwc_rect_t& dest = hwcLayer->getClippedFrame();
+    int srcW = (int)src.right - (int)src.left;
+    int srcH = (int)src.bottom - (int)src.top;
+    int dstW = dest.right - dest.left;
+    int dstH = dest.bottom - dest.top;
+    if (srcW == dstW && srcH == dstH) {
+        VTRACE("unscaled RGB layer, not an overlay candidate");
+        return false;
+    }
+
+    return checkSupported(DisplayPlane::PLANE_OVERLAY, hwcLayer);
+}
+
 bool HwcLayerList::checkCursorSupported(HwcLayer *hwcLayer)
 {
     hwc_layer_1_t& layer = *(hwcLayer->getLayer());
@@ -129,13 +235,16 @@ bool HwcLayerList::checkCursorSupported(HwcLayer *hwcLayer)
         return false;
     }
 
-    if (!(layer.flags & HWC_IS_CURSOR_LAYER)) {
+    bool opportunistic = !(layer.flags & HWC_IS_CURSOR_LAYER);
+    if (opportunistic && !mOpportunisticCursor) {
         VTRACE("not a cursor layer");
         return false;
     }
 
     if (hwcLayer->getIndex() != mLayerCount - 2) {
-        WTRACE("cursor layer is not on top of zorder");
+        if (!opportunistic) {
+            WTRACE("cursor layer is not on top of zorder");
+        }
         return false;
     }
 
@@ -150,6 +259,82 @@ bool HwcLayerList::checkCursorSupported(HwcLayer *hwcLayer)
         return false;
     }
 
+    if (opportunistic && !checkOpportunisticCursor(hwcLayer)) {
+        return false;
+    }
+
+    int verdict = hwcLayer->getVerdict(DisplayPlane::PLANE_CURSOR);
+    if (verdict != HwcLayer::VERDICT_UNKNOWN) {
+        return verdict == HwcLayer::VERDICT_SUPPORTED;
+    }
+
+    bool valid = checkCursorCapabilities(hwcLayer);
+    hwcLayer->setVerdict(DisplayPlane::PLANE_CURSOR, valid);
+    return valid;
+}
+
+bool HwcLayerList::checkOpportunisticCursor(HwcLayer *hwcLayer)
+{
+    hwc_layer_1_t& layer = *(hwcLayer->getLayer());
+
+    // the cursor plane may not exist on this platform or display
+    DisplayPlaneManager *planeManager = Hwcomposer::getInstance().getPlaneManager();
+    if (planeManager->getPlaneMask(mDisplayIndex, DisplayPlane::PLANE_CURSOR) == 0) {
+        return false;
+    }
+
+    // BGRA cursors are swizzled in place by the cursor plane, which is
+    // only acceptable for buffers owned by the pointer
+    if (hwcLayer->getFormat() != HAL_PIXEL_FORMAT_RGBA_8888) {
+        return false;
+    }
+
+    if (layer.transform != 0) {
+        return false;
+    }
+
+    // no plane alpha on the cursor plane
+    if (layer.planeAlpha != 0xff || layer.blending == HWC_BLENDING_COVERAGE) {
+        return false;
+    }
+
+    // the cursor plane fetches a packed square from the buffer origin
+    hwc_frect_t& src = layer.sourceCropf;
+    hwc_rect_t& dest = layer.displayFrame;
+    int size = (int)src.right;
+    if (src.left != 0 || src.top != 0 ||
+        src.right != (float)size || src.bottom != (float)size) {
+        return false;
+    }
+
+    if (size != CURSOR_SIZE_SMALL && size != CURSOR_SIZE_MEDIUM &&
+        size != CURSOR_SIZE_LARGE) {
+        return false;
+    }
+
+    if (dest.right - dest.left != size || dest.bottom - dest.top != size) {
+        VTRACE("scaled layer cannot use cursor plane");
+        return false;
+    }
+
+    if (hwcLayer->getBufferWidth() != (uint32_t)size ||
+        hwcLayer->getBufferHeight() < (uint32_t)size ||
+        hwcLayer->getBufferStride().rgb.stride != (uint32_t)size * 4) {
+        return false;
+    }
+
+    // cursor position is a signed 12-bit value
+    if (dest.left <= -CURSOR_POSITION_MAX || dest.left >= CURSOR_POSITION_MAX ||
+        dest.top <= -CURSOR_POSITION_MAX || dest.top >= CURSOR_POSITION_MAX) {
+        return false;
+    }
+
+    VTRACE("layer %d (%dx%d) uses cursor plane", hwcLayer->getIndex(), size, size);
+    return true;
+}
+
+bool HwcLayerList::checkCursorCapabilities(HwcLayer *hwcLayer)
+{
     uint32_t format = hwcLayer->getFormat();
     if (format != HAL_PIXEL_FORMAT_BGRA_8888 &&
         format != HAL_PIXEL_FORMAT_RGBA_8888) {
@@ -180,26 +365,97 @@ bool HwcLayerList::checkCursorSupported(HwcLayer *hwcLayer)
         return false;
     }
 
-    BufferManager *bm = Hwcomposer::getInstance().getBufferManager();
-    if (bm) {
-        DataBuffer *buffer = bm->lockDataBuffer(hwcLayer->getHandle());
-        if (buffer) {
-            uint32_t w = buffer->getWidth();
-            uint32_t h = buffer->getHeight();
+    // buffer size is loaded by the layer, no need to lock the buffer again
+    uint32_t w = hwcLayer->getBufferWidth();
+    uint32_t h = hwcLayer->getBufferHeight();
+    if ((w != 64 || h != 64) &&
+        (w != 128 || h != 128) &&
+        (w != 256 || h != 256)) {
+        return false;
+    }
 
-            if ((w != 64 || h != 64) &&
-                (w != 128 || h != 128) &&
-                (w != 256 || h != 256)) {
-                bm->unlockDataBuffer(buffer);
-                return false;
-            }
+    return true;
+}
+
+int HwcLayerList::getCandidateType(HwcLayer *hwcLayer)
+{
+    if (hwcLayer->getIndex() >= FRAMEBUFFER_TARGET_SLOT) {
+        // no room in Z order layer arena
+        VTRACE("layer %d is not a plane candidate", hwcLayer->getIndex());
+        return -1;
+    }
+
+    if (checkCursorSupported(hwcLayer)) {
+        return DisplayPlane::PLANE_CURSOR;
+    }
+    if (checkSupported(DisplayPlane::PLANE_SPRITE, hwcLayer)) {
+        return DisplayPlane::PLANE_SPRITE;
+    }
+    if (Hwcomposer::getInstance().getDisplayAnalyzer()->isOverlayAllowed()) {
+        uint32_t format = hwcLayer->getFormat();
+        bool isRGB = (format == HAL_PIXEL_FORMAT_BGRA_8888 ||
+                      format == HAL_PIXEL_FORMAT_BGRX_8888);
+        if (isRGB ? checkRgbOverlaySupported(hwcLayer) :
+            checkSupported(DisplayPlane::PLANE_OVERLAY, hwcLayer)) {
+            return DisplayPlane::PLANE_OVERLAY;
         }
-        bm->unlockDataBuffer(buffer);
+    }
+    return -1;
+}
+
+bool HwcLayerList::isSettled(HwcLayer *hwcLayer, int planeType)
+{
+    // protected content can only be shown through a plane
+    if (hwcLayer->isProtected()) {
+        return true;
     }
 
+    if (hwcLayer->getEligibleFrames() < mHysteresis[planeType]) {
+        VTRACE("layer %d is held back, eligible for %u of %u frames",
+            hwcLayer->getIndex(), hwcLayer->getEligibleFrames(), mHysteresis[planeType]);
+        return false;
+    }
     return true;
 }
 
+void HwcLayerList::updateEligibility()
+{
+    bool reassign = false;
+
+    for (int i = 0; i < mLayerCount - 1; i++) {
+        HwcLayer *hwcLayer = mLayers.itemAt(i);
+        if (!hwcLayer) {
+            continue;
+        }
+
+        if (hwcLayer->getPlane()) {
+            hwcLayer->setEligible(true);
+            continue;
+        }
+
+        // other layers are re-checked at geometry change only
+        if (!hwcLayer->isHeldBack()) {
+            continue;
+        }
+
+        int planeType = getCandidateType(hwcLayer);
+        hwcLayer->setEligible(planeType >= 0);
+
+        if (planeType < 0) {
+            // no longer eligible, stays on GPU until next geometry change
+            hwcLayer->setHeldBack(false);
+        } else if (hwcLayer->getEligibleFrames() >= mHysteresis[planeType]) {
+            // held back long enough, assign planes again
+            hwcLayer->setHeldBack(false);
+            reassign = true;
+        }
+    }
+
+    if (reassign) {
+        Hwcomposer::getInstance().getDisplayAnalyzer()->postPlaneReassignEvent(mDisplayIndex);
+    }
+}
+
 bool HwcLayerList::initialize()
 {
     if (!mList || mList->numHwLayers == 0) {
@@ -213,54 +469,96 @@ bool HwcLayerList::initialize()
     mSpriteCandidates.setCapacity(mLayerCount);
     mOverlayCandidates.setCapacity(mLayerCount);
     mCursorCandidates.setCapacity(mLayerCount);
-    mZOrderConfig.setCapacity(mLayerCount);
-    Hwcomposer& hwc = Hwcomposer::getInstance();
+    // layers hidden by the static layer cache in the previous frame
+    mLayerCache.restore(mList);
+
+    // hidden layers are marked as HWC_OVERLAY and skipped below
+    updateDisplayBounds();
+    cullLayers();
+
+    // static layer cache is kept while its layers are unchanged and its
+    // bottom layer is visible
+    int cacheBase = -1;
+    if (mLayerCache.isValid()) {
+        int base = mLayerCache.getBaseIndex();
+        if (mLayerCache.matches(mList) &&
+            mList->hwLayers[base].compositionType == HWC_FRAMEBUFFER) {
+            cacheBase = base;
+        } else {
+            mLayerCache.invalidate();
+        }
+    }
 
     for (int i = 0; i < mLayerCount; i++) {
         hwc_layer_1_t *layer = &mList->hwLayers[i];
         if (!layer) {
             DEINIT_AND_RETURN_FALSE("layer %d is null", i);
         }
+        int32_t compositionType = layer->compositionType;
 
-        HwcLayer *hwcLayer = new HwcLayer(i, layer);
+        HwcLayer *hwcLayer = reuseLayer(i, layer);
         if (!hwcLayer) {
             DEINIT_AND_RETURN_FALSE("failed to allocate hwc layer %d", i);
         }
+        hwcLayer->setDisplayBounds(mBounds);
+
+        // bottom layer of the cache scans out the cache buffer, other
+        // layers of the cache are hidden
+        if (cacheBase >= 0 && compositionType == HWC_FRAMEBUFFER &&
+            mLayerCache.contains(i)) {
+            if (i != cacheBase) {
+                hwcLayer->setType(HwcLayer::LAYER_SKIPPED);
+                mLayers.add(hwcLayer);
+                continue;
+            }
+            hwcLayer->setCacheBuffer(mLayerCache.getHandle());
+        }
 
-        if (layer->compositionType == HWC_FRAMEBUFFER_TARGET) {
+        if (compositionType == HWC_FRAMEBUFFER_TARGET) {
             hwcLayer->setType(HwcLayer::LAYER_FRAMEBUFFER_TARGET);
             mFrameBufferTarget = hwcLayer;
-        } else if (layer->compositionType == HWC_OVERLAY){
+        } else if (compositionType == HWC_OVERLAY){
             // skipped layer, filtered by Display Analyzer
             hwcLayer->setType(HwcLayer::LAYER_SKIPPED);
-        } else if (layer->compositionType == HWC_FORCE_FRAMEBUFFER) {
+        } else if (compositionType == HWC_FORCE_FRAMEBUFFER) {
             layer->compositionType = HWC_FRAMEBUFFER;
             hwcLayer->setType(HwcLayer::LAYER_FORCE_FB);
             // add layer to FB layer list for zorder check during plane assignment
             mFBLayers.add(hwcLayer);
-        } else  if (layer->compositionType == HWC_FRAMEBUFFER) {
+        } else  if (compositionType == HWC_FRAMEBUFFER) {
             // by default use GPU composition
             hwcLayer->setType(HwcLayer::LAYER_FB);
             mFBLayers.add(hwcLayer);
-            if (checkCursorSupported(hwcLayer)) {
+            int planeType = getCandidateType(hwcLayer);
+            if (planeType < 0) {
+                // noncandidate layer, restart its eligible frame count
+                hwcLayer->setEligible(false);
+            } else if (!isSettled(hwcLayer, planeType)) {
+                // recently ineligible, keep it on GPU for now
+                hwcLayer->setHeldBack(true);
+            } else if (planeType == DisplayPlane::PLANE_CURSOR) {
                 mCursorCandidates.add(hwcLayer);
-            } else if (checkSupported(DisplayPlane::PLANE_SPRITE, hwcLayer)) {
+            } else if (planeType == DisplayPlane::PLANE_SPRITE) {
                 mSpriteCandidates.add(hwcLayer);
-            } else if (hwc.getDisplayAnalyzer()->isOverlayAllowed() &&
-                checkSupported(DisplayPlane::PLANE_OVERLAY, hwcLayer)) {
-                mOverlayCandidates.add(hwcLayer);
             } else {
-                // noncandidate layer
+                mOverlayCandidates.add(hwcLayer);
             }
-        } else if (layer->compositionType == HWC_SIDEBAND){
+        } else if (compositionType == HWC_SIDEBAND){
             hwcLayer->setType(HwcLayer::LAYER_SIDEBAND);
         } else {
-            DEINIT_AND_RETURN_FALSE("invalid composition type %d", layer->compositionType);
+            DEINIT_AND_RETURN_FALSE("invalid composition type %d", compositionType);
         }
         // add layer to layer list
         mLayers.add(hwcLayer);
     }
 
+    // layers that have gone away with the geometry change
+    releaseRetiredLayers();
+
+    // let the plane manager balance shared planes between displays
+    publishPlaneDemand(DisplayPlane::PLANE_SPRITE, mSpriteCandidates);
+    publishPlaneDemand(DisplayPlane::PLANE_OVERLAY, mOverlayCandidates);
+
     if (mFrameBufferTarget == NULL) {
         ETRACE("no frame buffer target?");
         return false;
@@ -276,8 +574,27 @@ bool HwcLayerList::initialize()
         return true;
     }
 
+    mOverlap.build(mList);
     allocatePlanes();
 
+    // cache buffer is useless without a plane, its bottom layer is composed
+    // by GPU and the hidden layers inside it join it in frame buffer
+    if (cacheBase >= 0 && !mLayers.itemAt(cacheBase)->getPlane()) {
+        DTRACE("no plane for static layer cache");
+        for (int i = 0; i < mLayerCount - 1; i++) {
+            if (!mLayerCache.contains(i)) {
+                continue;
+            }
+            HwcLayer *hwcLayer = mLayers.itemAt(i);
+            hwcLayer->setCacheBuffer(0);
+            if (i != cacheBase) {
+                hwcLayer->setType(HwcLayer::LAYER_FB);
+                mFBLayers.add(hwcLayer);
+            }
+        }
+        mLayerCache.invalidate();
+    }
+
     //dump();
     return true;
 }
@@ -289,31 +606,678 @@ void HwcLayerList::deinitialize()
     }
 
     DisplayPlaneManager *planeManager = Hwcomposer::getInstance().getPlaneManager();
+    planeManager->setPlaneDemand(mDisplayIndex, DisplayPlane::PLANE_SPRITE, NULL, 0);
+    planeManager->setPlaneDemand(mDisplayIndex, DisplayPlane::PLANE_OVERLAY, NULL, 0);
+    for (int i = 0; i < (int)mLayers.size(); i++) {
+        HwcLayer *hwcLayer = mLayers.itemAt(i);
+        if (hwcLayer) {
+            DisplayPlane *plane = hwcLayer->detachPlane();
+            if (plane) {
+                planeManager->reclaimPlane(mDisplayIndex, *plane);
+            }
+            // keep the layer and its history for the next list
+            if (hwcLayer == mFrameBufferTarget) {
+                delete mRetiredTarget;
+                mRetiredTarget = hwcLayer;
+            } else {
+                mRetiredLayers.push_back(hwcLayer);
+            }
+        }
+    }
+
+    mLayers.clear();
+    mFBLayers.clear();
+    mOverlayCandidates.clear();
+    mSpriteCandidates.clear();
+    mCursorCandidates.clear();
+    mZOrderMask = 0;
+    mZOrderConfig.clear();
+    mFrameBufferTarget = NULL;
+    mTargetZOrder = -1;
+    mOverlap.invalidate();
+    mLayerCount = 0;
+}
+
+
+bool HwcLayerList::reset(hwc_display_contents_1_t *list)
+{
+    deinitialize();
+    mList = list;
+    return initialize();
+}
+
+void HwcLayerList::freezeHistory(bool frozen)
+{
+    for (size_t i = 0; i < mLayers.size(); i++) {
+        HwcLayer *hwcLayer = mLayers.itemAt(i);
+        if (hwcLayer) {
+            hwcLayer->freezeHistory(frozen);
+        }
+    }
+}
+
+HwcLayer* HwcLayerList::reuseLayer(int index, hwc_layer_1_t *layer)
+{
+    HwcLayer *hwcLayer = NULL;
+
+    if (layer->compositionType == HWC_FRAMEBUFFER_TARGET) {
+        hwcLayer = mRetiredTarget;
+        mRetiredTarget = NULL;
+    } else {
+        // match by buffer handle first, then by position
+        int match = -1;
+        for (size_t i = 0; i < mRetiredLayers.size(); i++) {
+            HwcLayer *retired = mRetiredLayers.itemAt(i);
+            if (layer->handle && retired->getHandle() == layer->handle) {
+                match = i;
+                break;
+            }
+            // the previous list is gone, compare against the cached frame
+            const hwc_rect_t& a = retired->getDisplayFrame();
+            const hwc_rect_t& b = layer->displayFrame;
+            if (match < 0 &&
+                a.left == b.left && a.top == b.top &&
+                a.right == b.right && a.bottom == b.bottom) {
+                match = i;
+            }
+        }
+        if (match >= 0) {
+            hwcLayer = mRetiredLayers.itemAt(match);
+            mRetiredLayers.removeAt(match);
+        }
+    }
+
+    if (hwcLayer) {
+        hwcLayer->reset(index, layer);
+        return hwcLayer;
+    }
+
+    return new HwcLayer(index, layer);
+}
+
+void HwcLayerList::publishPlaneDemand(int planeType, PriorityVector& candidates)
+{
+    enum {
+        MAX_DEMAND = 8,
+    };
+
+    // display frame areas of candidates, largest first
+    uint32_t areas[MAX_DEMAND];
+    int count = 0;
+    for (size_t i = 0; i < candidates.size(); i++) {
+        uint32_t area = getVisibleArea(candidates[i]);
+        int j = (count < MAX_DEMAND) ? count++ : MAX_DEMAND;
+        while (j > 0 && areas[j - 1] < area) {
+            if (j < MAX_DEMAND) {
+                areas[j] = areas[j - 1];
+            }
+            j--;
+        }
+        if (j < MAX_DEMAND) {
+            areas[j] = area;
+        }
+    }
+
+    DisplayPlaneManager *planeManager = Hwcomposer::getInstance().getPlaneManager();
+    planeManager->setPlaneDemand(mDisplayIndex, planeType, areas, count);
+}
+
+void HwcLayerList::cullLayers()
+{
+    hwc_rect_t opaque[MAX_ZORDER_LAYERS];
+    int opaqueCount = 0;
+
+    mCulledLayers = 0;
+    mCulledArea = 0;
+
+    // walk from top to bottom, frame buffer target excluded
+    for (int i = mLayerCount - 2; i >= 0; i--) {
+        hwc_layer_1_t *layer = &mList->hwLayers[i];
+        hwc_rect_t visible = layer->displayFrame;
+
+        // skip layers are drawn by surface flinger, leave them alone
+        bool cullable = layer->compositionType == HWC_FRAMEBUFFER &&
+                        !(layer->flags & HWC_SKIP_LAYER) &&
+                        !(layer->flags & HWC_IS_CURSOR_LAYER);
+
+        bool hidden = cullable &&
+                      layer->planeAlpha == 0 &&
+                      layer->blending != HWC_BLENDING_NONE;
+
+        // part of the layer outside the screen is never seen
+        if (mBounds.right > mBounds.left && mBounds.bottom > mBounds.top) {
+            if (visible.left < mBounds.left)
+                visible.left = mBounds.left;
+            if (visible.top < mBounds.top)
+                visible.top = mBounds.top;
+            if (visible.right > mBounds.right)
+                visible.right = mBounds.right;
+            if (visible.bottom > mBounds.bottom)
+                visible.bottom = mBounds.bottom;
+            if (visible.right <= visible.left || visible.bottom <= visible.top) {
+                hidden = cullable;
+            }
+        }
+
+        // opaque layers above take their part of the visible region, the
+        // layer is hidden if nothing is left even if no single occluder
+        // covers it
+        VisibleRegion region;
+        region.set(visible);
+        for (int j = 0; j < opaqueCount && !hidden && !region.isEmpty(); j++) {
+            region.subtract(opaque[j]);
+        }
+        if (region.isEmpty()) {
+            hidden = cullable;
+        }
+
+        if (hidden) {
+            uint32_t area = (uint32_t)(layer->displayFrame.right - layer->displayFrame.left) *
+                            (uint32_t)(layer->displayFrame.bottom - layer->displayFrame.top);
+            VTRACE("layer %d is hidden, %u pixels culled", i, area);
+            // composed by no one, surface flinger skips HWC_OVERLAY layers
+            layer->compositionType = HWC_OVERLAY;
+            mCulledLayers++;
+            mCulledArea += area;
+            region.clear();
+        } else if (isOpaque(layer) && opaqueCount < MAX_ZORDER_LAYERS) {
+            opaque[opaqueCount++] = layer->displayFrame;
+        }
+
+        if (i < MAX_ZORDER_LAYERS) {
+            mVisibleAreas[i] = region.getArea();
+        }
+    }
+}
+
+void HwcLayerList::updateDisplayBounds()
+{
+    drmModeModeInfo mode;
+    Drm *drm = Hwcomposer::getInstance().getDrm();
+
+    memset(&mBounds, 0, sizeof(mBounds));
+    if (mDisplayIndex == IDisplayDevice::DEVICE_VIRTUAL ||
+        !drm->getModeInfo(mDisplayIndex, mode)) {
+        // no clipping without a known mode
+        return;
+    }
+    mBounds.right = mode.hdisplay;
+    mBounds.bottom = mode.vdisplay;
+}
+
+bool HwcLayerList::isOpaque(hwc_layer_1_t *layer)
+{
+    return layer->compositionType == HWC_FRAMEBUFFER &&
+           !(layer->flags & HWC_SKIP_LAYER) &&
+           layer->handle != 0 &&
+           layer->blending == HWC_BLENDING_NONE &&
+           layer->planeAlpha == 0xff;
+}
+
+void HwcLayerList::updateVideoActivity()
+{
+    // video is paused when every video layer has repeated its frame long
+    // enough, the display can then go idle as if there were no video
+    int videoLayers = 0;
+    bool paused = true;
+    for (int i = 0; i < mLayerCount - 1; i++) {
+        HwcLayer *hwcLayer = mLayers.itemAt(i);
+        if (!hwcLayer || !DisplayQuery::isVideoFormat(hwcLayer->getFormat())) {
+            continue;
+        }
+        videoLayers++;
+        if (!hwcLayer->isUpdated()) {
+            mRepeatedVideoFrames++;
+        }
+        if (hwcLayer->getStaticCount() < LAYER_STATIC_THRESHOLD) {
+            paused = false;
+        }
+    }
+    setVideoPaused(paused && videoLayers > 0);
+}
+
+bool HwcLayerList::paceVideo()
+{
+    // the largest updated video layer on a plane is paced, the frame can
+    // only be deferred if it is the only update so that nothing else is
+    // delayed. A deferred frame is not updated when it is presented again
+    int video = -1;
+    uint32_t videoArea = 0;
+    bool others = false;
+    for (int i = 0; i < mLayerCount - 1; i++) {
+        HwcLayer *hwcLayer = mLayers.itemAt(i);
+        if (!hwcLayer || !hwcLayer->getPlane() || !hwcLayer->isUpdated()) {
+            continue;
+        }
+        if (!DisplayQuery::isVideoFormat(hwcLayer->getFormat())) {
+            others = true;
+            continue;
+        }
+        uint32_t area = getVisibleArea(hwcLayer);
+        if (video >= 0) {
+            others = true;
+            if (area <= videoArea) {
+                continue;
+            }
+        }
+        video = i;
+        videoArea = area;
+    }
+
+    if (video < 0) {
+        return false;
+    }
+
+    buffer_handle_t khandle;
+    int64_t pts;
+    nsecs_t lastVsync, period;
+    VsyncManager *vsyncManager = Hwcomposer::getInstance().getVsyncManager();
+    if (!mLayers.itemAt(video)->getVideoPayload(khandle, pts) ||
+        !vsyncManager ||
+        !vsyncManager->getVsyncTimeline(mDisplayIndex, lastVsync, period)) {
+        mVideoPacer.reset();
+        return false;
+    }
+
+    bool damaged = mDamage.right > mDamage.left && mDamage.bottom > mDamage.top;
+    bool allowDefer = mVideoPacing && !others && !damaged;
+    bool defer = mVideoPacer.schedule(pts, systemTime(SYSTEM_TIME_MONOTONIC),
+                                      lastVsync, period, allowDefer);
+    if (defer) {
+        VTRACE("deferring video frame %lld", pts);
+    }
+    return defer;
+}
+
+void HwcLayerList::setVideoPaused(bool paused)
+{
+    if (paused == mVideoPaused) {
+        return;
+    }
+
+    DTRACE("video on device %d is %s", mDisplayIndex,
+           paused ? "paused" : "playing");
+    mVideoPaused = paused;
+    DisplayAnalyzer *analyzer = Hwcomposer::getInstance().getDisplayAnalyzer();
+    if (analyzer) {
+        analyzer->setVideoPaused(mDisplayIndex, paused);
+    }
+}
+
+void HwcLayerList::updateDamage()
+{
+    memset(&mDamage, 0, sizeof(mDamage));
+
+    // only frame buffer layers contribute to the frame buffer target
+    bool empty = true;
+    for (size_t i = 0; i < mFBLayers.size(); i++) {
+        HwcLayer *hwcLayer = mFBLayers.itemAt(i);
+        if (!hwcLayer->isUpdated()) {
+            continue;
+        }
+
+        const hwc_rect_t& frame = hwcLayer->getClippedFrame();
+        if (frame.right <= frame.left || frame.bottom <= frame.top) {
+            continue;
+        }
+
+        if (empty) {
+            mDamage = frame;
+            empty = false;
+        } else {
+            if (frame.left < mDamage.left)
+                mDamage.left = frame.left;
+            if (frame.top < mDamage.top)
+                mDamage.top = frame.top;
+            if (frame.right > mDamage.right)
+                mDamage.right = frame.right;
+            if (frame.bottom > mDamage.bottom)
+                mDamage.bottom = frame.bottom;
+        }
+    }
+
+    uint64_t screen = (uint64_t)(mBounds.right - mBounds.left) *
+                      (uint64_t)(mBounds.bottom - mBounds.top);
+    if (screen == 0) {
+        // statistics are relative to the screen size
+        return;
+    }
+
+    uint64_t area = (uint64_t)(mDamage.right - mDamage.left) *
+                    (uint64_t)(mDamage.bottom - mDamage.top);
+    mDamageFrames++;
+    mDamageAreaTotal += area;
+    mScreenAreaTotal += screen;
+    if (area == 0) {
+        // frame buffer target is left as it is, see setupSmartComposition
+        mEmptyDamageFrames++;
+    } else if (area * 100 < screen * mDamageThreshold) {
+        VTRACE("partial damage (%d, %d, %d, %d)",
+               mDamage.left, mDamage.top, mDamage.right, mDamage.bottom);
+        mPartialDamageFrames++;
+    }
+}
+
+uint32_t HwcLayerList::getVisibleArea(HwcLayer *hwcLayer)
+{
+    int index = hwcLayer->getIndex();
+    if (index < MAX_ZORDER_LAYERS) {
+        return mVisibleAreas[index];
+    }
+
+    const hwc_rect_t& frame = hwcLayer->getLayer()->displayFrame;
+    if (frame.right <= frame.left || frame.bottom <= frame.top) {
+        return 0;
+    }
+    return (uint32_t)(frame.right - frame.left) * (uint32_t)(frame.bottom - frame.top);
+}
+
+void HwcLayerList::releaseRetiredLayers()
+{
+    for (size_t i = 0; i < mRetiredLayers.size(); i++) {
+        delete mRetiredLayers.itemAt(i);
+    }
+    mRetiredLayers.clear();
+
+    delete mRetiredTarget;
+    mRetiredTarget = NULL;
+}
+
+bool HwcLayerList::allocatePlanes()
+{
+    // layout planned by smart composition 2 for its fallback to frame buffer
+    if (mSc2Solution.count > 0) {
+        PlaneAssignmentCache::Solution solution = mSc2Solution;
+        mSc2Solution.count = 0;
+        if (applySolution(solution)) {
+            VTRACE("smart composition 2 layout applied");
+            return true;
+        }
+        DTRACE("smart composition 2 layout rejected, fall back to search");
+        mSc2Rejected++;
+    }
+
+    PlaneAssignmentCache *cache = Hwcomposer::getInstance().getPlaneAssignmentCache();
+    PlaneAssignmentCache::Signature sig;
+    bool cacheable = cache && buildSignature(sig);
+
+    if (cacheable) {
+        PlaneAssignmentCache::Solution solution;
+        if (cache->lookup(sig, solution)) {
+            if (applySolution(solution)) {
+                VTRACE("plane assignment cache hit");
+                return true;
+            }
+            DTRACE("stale plane assignment, fall back to search");
+            cache->invalidate(sig);
+        }
+    }
+
+    mSolution.count = 0;
+    bool ok = false;
+    if (mSolverMode == SOLVER_MIN_COST) {
+        ok = solvePlanes();
+    }
+    if (!ok) {
+        ok = assignCursorPlanes();
+    }
+    if (ok && cacheable) {
+        cache->insert(sig, mSolution);
+    }
+    return ok;
+}
+
+bool HwcLayerList::solvePlanes()
+{
+    // Branch and bound search over the plane candidates. Each candidate is
+    // either offloaded to a plane of its candidate type or left to GPU, the
+    // cost of a solution is the frame area still composited by GPU. The
+    // search returns the cheapest feasible Z order found within the budget,
+    // feasibility is checked with isValidZOrder and testPlanes so that no
+    // plane is taken before the best solution is known.
+    SolverState& st = mSolver;
+    st.candidateCount = 0;
+    st.nodes = 0;
+    st.bestCost = -1;
+    st.best.count = 0;
+
+    PriorityVector *lists[] = {&mCursorCandidates, &mOverlayCandidates, &mSpriteCandidates};
+    int types[] = {DisplayPlane::PLANE_CURSOR, DisplayPlane::PLANE_OVERLAY, DisplayPlane::PLANE_SPRITE};
+    for (int i = 0; i < 3; i++) {
+        for (size_t j = 0; j < lists[i]->size(); j++) {
+            if (st.candidateCount >= SOLVER_MAX_CANDIDATES) {
+                DTRACE("too many candidates, use greedy plane assignment");
+                return false;
+            }
+            HwcLayer *hwcLayer = lists[i]->itemAt(j);
+            hwc_rect_t& frame = hwcLayer->getLayer()->displayFrame;
+            SolverCandidate& c = st.candidates[st.candidateCount++];
+            c.hwcLayer = hwcLayer;
+            c.planeType = types[i];
+            c.area = (frame.right - frame.left) * (frame.bottom - frame.top);
+        }
+    }
+
+    // visit larger layers first so that good solutions are found early
+    for (int i = 1; i < st.candidateCount; i++) {
+        SolverCandidate c = st.candidates[i];
+        int j = i - 1;
+        while (j >= 0 && st.candidates[j].area < c.area) {
+            st.candidates[j + 1] = st.candidates[j];
+            j--;
+        }
+        st.candidates[j + 1] = c;
+    }
+
+    DisplayPlaneManager *planeManager = Hwcomposer::getInstance().getPlaneManager();
+    for (int i = 0; i < DisplayPlane::PLANE_MAX; i++) {
+        st.freePlanes[i] = planeManager->getFreePlanes(mDisplayIndex, i);
+    }
+
+    int cost = 0;
+    for (size_t i = 0; i < mFBLayers.size(); i++) {
+        hwc_rect_t& frame = mFBLayers[i]->getLayer()->displayFrame;
+        cost += (frame.right - frame.left) * (frame.bottom - frame.top);
+    }
+
+    int gain = 0;
+    for (int i = 0; i < st.candidateCount; i++) {
+        gain += st.candidates[i].area;
+    }
+
+    solvePlanes(0, cost, gain);
+
+    VTRACE("visited %d nodes, budget %d, best cost %d", st.nodes, st.budget, st.bestCost);
+    if (st.nodes > st.budget) {
+        DTRACE("plane solver budget exhausted, best cost %d", st.bestCost);
+    }
+
+    if (st.bestCost < 0) {
+        return false;
+    }
+
+    return applySolution(st.best);
+}
+
+void HwcLayerList::solvePlanes(int index, int cost, int gain)
+{
+    SolverState& st = mSolver;
+
+    if (++st.nodes > st.budget) {
+        return;
+    }
+
+    // bound: even offloading every remaining candidate can't beat the best
+    if (st.bestCost >= 0 && cost - gain >= st.bestCost) {
+        return;
+    }
+
+    if (index == st.candidateCount) {
+        solveLeaf(cost);
+        return;
+    }
+
+    SolverCandidate& c = st.candidates[index];
+    if (st.freePlanes[c.planeType] > 0) {
+        st.freePlanes[c.planeType]--;
+        ZOrderLayer *zlayer = addZOrderLayer(c.planeType, c.hwcLayer);
+        solvePlanes(index + 1, cost - c.area, gain - c.area);
+        removeZOrderLayer(zlayer);
+        st.freePlanes[c.planeType]++;
+    }
+
+    solvePlanes(index + 1, cost, gain - c.area);
+}
+
+void HwcLayerList::solveLeaf(int cost)
+{
+    SolverState& st = mSolver;
+
+    HwcLayer *remaining = NULL;
+    int remainingCount = 0;
+    for (size_t i = 0; i < mFBLayers.size(); i++) {
+        if (!mFBLayers[i]->mPlaneCandidate) {
+            remaining = mFBLayers[i];
+            remainingCount++;
+        }
+    }
+
+    ZOrderLayer *zlayer = NULL;
+    bool ok = false;
+
+    if (remainingCount == 0) {
+        // every layer is offloaded, frame buffer target is not needed
+        ok = testZOrderConfig();
+    } else if (remainingCount == (int)mFBLayers.size()) {
+        // nothing offloaded, compose everything to frame buffer target
+        zlayer = addZOrderLayer(DisplayPlane::PLANE_PRIMARY, mFrameBufferTarget, 0);
+        ok = testZOrderConfig();
+    } else {
+        if (remainingCount == 1 && remaining->getType() == HwcLayer::LAYER_FB &&
+            (int)mSpriteCandidates.indexOf(remaining) >= 0) {
+            // primary plane is configured as sprite for the last layer
+            zlayer = addZOrderLayer(DisplayPlane::PLANE_PRIMARY, remaining);
+            ok = testZOrderConfig();
+            if (ok) {
+                cost = 0;
+            } else {
+                removeZOrderLayer(zlayer);
+                zlayer = NULL;
+            }
+        }
+
+        for (size_t i = 0; i < mFBLayers.size() && !ok; i++) {
+            HwcLayer *target = mFBLayers[i];
+            if (target->mPlaneCandidate || !useAsFrameBufferTarget(target)) {
+                continue;
+            }
+            zlayer = addZOrderLayer(DisplayPlane::PLANE_PRIMARY,
+                                    mFrameBufferTarget,
+                                    target->getZOrder());
+            ok = testZOrderConfig();
+            if (!ok) {
+                removeZOrderLayer(zlayer);
+                zlayer = NULL;
+            }
+        }
+    }
+
+    if (ok && (st.bestCost < 0 || cost < st.bestCost) &&
+        getZOrderLayerCount() <= PlaneAssignmentCache::MAX_ASSIGNMENTS) {
+        ZOrderConfig& config = buildZOrderConfig();
+        st.bestCost = cost;
+        st.best.count = (int)config.size();
+        for (int i = 0; i < st.best.count; i++) {
+            ZOrderLayer *l = config.itemAt(i);
+            st.best.assignments[i].layerIndex = l->hwcLayer->getIndex();
+            st.best.assignments[i].planeType = l->planeType;
+            st.best.assignments[i].zorder = l->zorder;
+        }
+    }
+
+    if (zlayer) {
+        removeZOrderLayer(zlayer);
+    }
+}
+
+bool HwcLayerList::testZOrderConfig()
+{
+    DisplayPlaneManager *planeManager = Hwcomposer::getInstance().getPlaneManager();
+    ZOrderConfig& config = buildZOrderConfig();
+    return planeManager->isValidZOrder(mDisplayIndex, config) &&
+           planeManager->testPlanes(mDisplayIndex, config);
+}
+
+bool HwcLayerList::buildSignature(PlaneAssignmentCache::Signature& sig)
+{
+    if (mLayerCount > PlaneAssignmentCache::MAX_LAYERS) {
+        VTRACE("too many layers (%d) to cache plane assignment", mLayerCount);
+        return false;
+    }
+
+    DisplayPlaneManager *planeManager = Hwcomposer::getInstance().getPlaneManager();
+    sig.reset(mDisplayIndex, mLayerCount);
+    for (int i = 0; i < DisplayPlane::PLANE_MAX; i++) {
+        sig.setFreePlanes(i, planeManager->getPlaneMask(mDisplayIndex, i));
+    }
+
     for (int i = 0; i < mLayerCount; i++) {
         HwcLayer *hwcLayer = mLayers.itemAt(i);
-        if (hwcLayer) {
-            DisplayPlane *plane = hwcLayer->detachPlane();
-            if (plane) {
-                planeManager->reclaimPlane(mDisplayIndex, *plane);
-            }
+        hwc_layer_1_t *layer = hwcLayer->getLayer();
+
+        int candidate = PlaneAssignmentCache::CANDIDATE_NONE;
+        if (mCursorCandidates.indexOf(hwcLayer) >= 0) {
+            candidate = PlaneAssignmentCache::CANDIDATE_CURSOR;
+        } else if (mSpriteCandidates.indexOf(hwcLayer) >= 0) {
+            candidate = PlaneAssignmentCache::CANDIDATE_SPRITE;
+        } else if (mOverlayCandidates.indexOf(hwcLayer) >= 0) {
+            candidate = PlaneAssignmentCache::CANDIDATE_OVERLAY;
         }
-        delete hwcLayer;
+
+        // overlapping layers constrain the Z order of frame buffer target
+        uint32_t overlap = mOverlap.isValid() ? mOverlap.row(i) : 0;
+
+        const hwc_frect_t& crop = hwcLayer->getClippedCrop();
+        const hwc_rect_t& frame = hwcLayer->getClippedFrame();
+        uint32_t attributes = PlaneAssignmentCache::packAttributes(
+            candidate,
+            hwcLayer->getType(),
+            layer->transform,
+            layer->blending,
+            layer->planeAlpha,
+            (int)crop.right - (int)crop.left,
+            (int)crop.bottom - (int)crop.top,
+            frame.right - frame.left,
+            frame.bottom - frame.top);
+
+        sig.addLayer(hwcLayer->getFormat(), attributes, overlap);
     }
 
-    mLayers.clear();
-    mFBLayers.clear();
-    mOverlayCandidates.clear();
-    mSpriteCandidates.clear();
-    mCursorCandidates.clear();
-    mZOrderConfig.clear();
-    mFrameBufferTarget = NULL;
-    mLayerCount = 0;
+    sig.seal();
+    return true;
 }
 
-
-bool HwcLayerList::allocatePlanes()
+bool HwcLayerList::applySolution(const PlaneAssignmentCache::Solution& solution)
 {
-    return assignCursorPlanes();
+    for (int i = 0; i < solution.count; i++) {
+        const PlaneAssignmentCache::Assignment& a = solution.assignments[i];
+        if (a.layerIndex < 0 || a.layerIndex >= mLayerCount) {
+            ETRACE("invalid layer index %d in cached assignment", a.layerIndex);
+            break;
+        }
+        addZOrderLayer(a.planeType, mLayers.itemAt(a.layerIndex), a.zorder);
+    }
+
+    if (getZOrderLayerCount() == solution.count) {
+        mSolution.count = 0;
+        if (attachPlanes()) {
+            return true;
+        }
+    }
+
+    // roll back, planes were not taken
+    clearZOrderLayers();
+    return false;
 }
 
 bool HwcLayerList::assignCursorPlanes()
@@ -341,7 +1305,7 @@ bool HwcLayerList::assignCursorPlanes()
         if (assignCursorPlanes(0, i)) {
             return true;
         }
-        if (mZOrderConfig.size() != 0) {
+        if (mZOrderMask != 0) {
             ETRACE("ZOrder config is not cleaned up!");
         }
     }
@@ -391,7 +1355,7 @@ bool HwcLayerList::assignOverlayPlanes()
         if (assignOverlayPlanes(0, i)) {
             return true;
         }
-        if (mZOrderConfig.size() != 0) {
+        if (mZOrderMask != 0) {
             ETRACE("ZOrder config is not cleaned up!");
         }
     }
@@ -444,7 +1408,7 @@ bool HwcLayerList::assignSpritePlanes()
             return true;
         }
 
-        if (mOverlayCandidates.size() == 0 && mZOrderConfig.size() != 0) {
+        if (mOverlayCandidates.size() == 0 && mZOrderMask != 0) {
             ETRACE("ZOrder config is not cleaned up!");
         }
     }
@@ -480,7 +1444,7 @@ bool HwcLayerList::assignPrimaryPlane()
         spriteLayer = mSpriteCandidates[i];
     }
 
-    int candidates = (int)mZOrderConfig.size();
+    int candidates = getZOrderLayerCount();
     int layers = (int)mFBLayers.size();
     bool ok = false;
 
@@ -538,24 +1502,43 @@ bool HwcLayerList::assignPrimaryPlaneHelper(HwcLayer *hwcLayer, int zorder)
 bool HwcLayerList::attachPlanes()
 {
     DisplayPlaneManager *planeManager = Hwcomposer::getInstance().getPlaneManager();
-    if (!planeManager->isValidZOrder(mDisplayIndex, mZOrderConfig)) {
-        VTRACE("invalid z order, size of config %d", mZOrderConfig.size());
+    ZOrderConfig& config = buildZOrderConfig();
+    if (!planeManager->isValidZOrder(mDisplayIndex, config)) {
+        VTRACE("invalid z order, size of config %d", config.size());
         return false;
     }
 
-    if (!planeManager->assignPlanes(mDisplayIndex, mZOrderConfig)) {
+    // record requested plane types before assignPlanes overrides them
+    int count = (int)config.size();
+    if (count > PlaneAssignmentCache::MAX_ASSIGNMENTS) {
+        count = -1;
+    }
+    for (int i = 0; i < count; i++) {
+        ZOrderLayer *zlayer = config.itemAt(i);
+        mSolution.assignments[i].layerIndex = zlayer->hwcLayer->getIndex();
+        mSolution.assignments[i].planeType = zlayer->planeType;
+        mSolution.assignments[i].zorder = zlayer->zorder;
+    }
+    mSolution.count = count;
+
+    if (!planeManager->assignPlanes(mDisplayIndex, config)) {
         WTRACE("failed to assign planes");
         return false;
     }
 
     VTRACE("============= plane assignment===================");
-    for (int i = 0; i < (int)mZOrderConfig.size(); i++) {
-        ZOrderLayer *zlayer = mZOrderConfig.itemAt(i);
+    mTargetZOrder = -1;
+    for (int i = 0; i < (int)config.size(); i++) {
+        ZOrderLayer *zlayer = config.itemAt(i);
         if (zlayer->plane == NULL || zlayer->hwcLayer == NULL) {
             ETRACE("invalid ZOrderLayer, should never happen!!");
             return false;
         }
 
+        if (zlayer->hwcLayer == mFrameBufferTarget) {
+            mTargetZOrder = zlayer->zorder;
+        }
+
         zlayer->plane->setZOrder(i);
 
         if (zlayer->plane->getType() == DisplayPlane::PLANE_CURSOR) {
@@ -575,15 +1558,39 @@ bool HwcLayerList::attachPlanes()
             zlayer->plane->getType(),
             zlayer->plane->getIndex(),
             zlayer->zorder);
-
-        delete zlayer;
     }
 
+    // attached layers stay marked as plane candidates
+    mZOrderMask = 0;
     mZOrderConfig.clear();
     return true;
 }
 
 bool HwcLayerList::useAsFrameBufferTarget(HwcLayer *target)
+{
+    if (!mOverlap.isValid()) {
+        return useAsFrameBufferTargetSlow(target);
+    }
+
+    // same rules as useAsFrameBufferTargetSlow, evaluated on bitmaps indexed
+    // by layer: no candidate layer between a noncandidate layer and the
+    // target layer can overlap the noncandidate layer
+    uint32_t candidates = 0;
+    uint32_t noncandidates = 0;
+    for (size_t i = 0; i < mFBLayers.size(); i++) {
+        uint32_t bit = 1U << mFBLayers[i]->getIndex();
+        if (mFBLayers[i]->mPlaneCandidate) {
+            candidates |= bit;
+        } else {
+            noncandidates |= bit;
+        }
+    }
+
+    int targetIndex = target->getIndex();
+    return mOverlap.canMerge(noncandidates & ~(1U << targetIndex), candidates, targetIndex);
+}
+
+bool HwcLayerList::useAsFrameBufferTargetSlow(HwcLayer *target)
 {
     // check if zorder of target can be used as zorder of frame buffer target
     // eligible only when all noncandidate layers can be merged to the target layer:
@@ -649,9 +1656,73 @@ bool HwcLayerList::hasIntersection(HwcLayer *la, HwcLayer *lb)
     return true;
 }
 
+bool HwcLayerList::isAssignmentReusable() const
+{
+    // layers pushed to frame buffer by a fallback or by smart composition
+    // get their next chance of a plane at geometry change
+    if (mStaticLayersIndex.size() > 0) {
+        return false;
+    }
+
+    for (int i = 0; i < mLayerCount - 1; i++) {
+        HwcLayer *hwcLayer = mLayers.itemAt(i);
+        if (!hwcLayer || hwcLayer->getType() == HwcLayer::LAYER_FORCE_FB) {
+            return false;
+        }
+    }
+    return mLayerCount > 0;
+}
+
+bool HwcLayerList::demoteLayer(HwcLayer *hwcLayer)
+{
+    // frame buffer target must be on a plane to take the layer
+    if (hwcLayer == mFrameBufferTarget ||
+        hwcLayer->getPlane() == NULL ||
+        mFrameBufferTarget == NULL ||
+        mFrameBufferTarget->getPlane() == NULL ||
+        mTargetZOrder < 0) {
+        return false;
+    }
+
+    // the layer is moved to the Z order of frame buffer target, no plane
+    // layer in between can overlap it
+    int zorder = hwcLayer->getZOrder();
+    int low = zorder < mTargetZOrder ? zorder : mTargetZOrder;
+    int high = zorder < mTargetZOrder ? mTargetZOrder : zorder;
+    for (int i = 0; i < mLayerCount - 1; i++) {
+        HwcLayer *other = mLayers.itemAt(i);
+        if (other == hwcLayer || other->getPlane() == NULL) {
+            continue;
+        }
+        if (other->getZOrder() <= low || other->getZOrder() >= high) {
+            continue;
+        }
+        if (hasIntersection(other, hwcLayer)) {
+            VTRACE("layer %d overlaps plane layer %d", hwcLayer->getIndex(), i);
+            return false;
+        }
+    }
+
+    DisplayPlaneManager *planeManager = Hwcomposer::getInstance().getPlaneManager();
+    DisplayPlane *plane = hwcLayer->detachPlane();
+    if (plane) {
+        planeManager->reclaimPlane(mDisplayIndex, *plane);
+    }
+    hwcLayer->mPlaneCandidate = false;
+    hwcLayer->setType(HwcLayer::LAYER_FORCE_FB);
+    mFBLayers.add(hwcLayer);
+    return true;
+}
+
 ZOrderLayer* HwcLayerList::addZOrderLayer(int type, HwcLayer *hwcLayer, int zorder)
 {
-    ZOrderLayer *layer = new ZOrderLayer;
+    int slot = getZOrderSlot(hwcLayer);
+    if (slot < 0) {
+        ETRACE("no Z order slot for layer %d", hwcLayer->getIndex());
+        return NULL;
+    }
+
+    ZOrderLayer *layer = &mZOrderLayers[slot];
     layer->planeType = type;
     layer->hwcLayer = hwcLayer;
     layer->zorder = (zorder != -1) ? zorder : hwcLayer->getZOrder();
@@ -663,55 +1734,116 @@ ZOrderLayer* HwcLayerList::addZOrderLayer(int type, HwcLayer *hwcLayer, int zord
 
     hwcLayer->mPlaneCandidate = true;
 
-    if ((int)mZOrderConfig.indexOf(layer) >= 0) {
+    if (mZOrderMask & (1U << slot)) {
         ETRACE("layer exists!");
     }
 
-    mZOrderConfig.add(layer);
+    mZOrderMask |= (1U << slot);
     return layer;
 }
 
 void HwcLayerList::removeZOrderLayer(ZOrderLayer *layer)
 {
-    if ((int)mZOrderConfig.indexOf(layer) < 0) {
+    if (layer == NULL) {
+        return;
+    }
+
+    int slot = layer - mZOrderLayers;
+    if ((mZOrderMask & (1U << slot)) == 0) {
         ETRACE("layer does not exist!");
     }
 
-    mZOrderConfig.remove(layer);
+    mZOrderMask &= ~(1U << slot);
 
     if (layer->hwcLayer->mPlaneCandidate == false) {
         ETRACE("plane is not candidate!, order %d", layer->zorder);
     }
     layer->hwcLayer->mPlaneCandidate = false;
-    delete layer;
 }
 
-void HwcLayerList::addStaticLayerSize(HwcLayer *hwcLayer)
+void HwcLayerList::clearZOrderLayers()
 {
-    // Calculate static layer size to avoid only composition navigation bar
-    // and status bar etc.
-    hwc_layer_1_t *a = hwcLayer->getLayer();
-    hwc_rect_t *Rect = &a->displayFrame;
+    for (int slot = 0; mZOrderMask != 0; slot++) {
+        if (mZOrderMask & (1U << slot)) {
+            mZOrderMask &= ~(1U << slot);
+            mZOrderLayers[slot].hwcLayer->mPlaneCandidate = false;
+        }
+    }
+    mZOrderConfig.clear();
+}
 
-    mLayerSize = mLayerSize + ((Rect->right - Rect->left) * (Rect->bottom - Rect->top));
+int HwcLayerList::getZOrderLayerCount() const
+{
+    return __builtin_popcount(mZOrderMask);
 }
 
-bool HwcLayerList::checkStaticLayerSize()
+int HwcLayerList::getZOrderSlot(HwcLayer *hwcLayer) const
 {
-    // Check static layer size if over threshold: half display size
-    bool ret = false;
-    int width = 0;
-    int height = 0;
-    drmModeModeInfo mode;
-    Drm *drm = Hwcomposer::getInstance().getDrm();
-    drm->getModeInfo(mDisplayIndex, mode);
-    width = mode.hdisplay;
-    height = mode.vdisplay;
+    if (hwcLayer == mFrameBufferTarget) {
+        return FRAMEBUFFER_TARGET_SLOT;
+    }
 
-    if (mLayerSize > (width * height/2))
-        ret = true;
+    int index = hwcLayer->getIndex();
+    if (index < 0 || index >= FRAMEBUFFER_TARGET_SLOT) {
+        return -1;
+    }
+    return index;
+}
 
-    return ret;
+ZOrderConfig& HwcLayerList::buildZOrderConfig()
+{
+    mZOrderConfig.clear();
+    uint32_t mask = mZOrderMask;
+    for (int slot = 0; mask != 0; slot++) {
+        if (mask & (1U << slot)) {
+            mask &= ~(1U << slot);
+            mZOrderConfig.add(&mZOrderLayers[slot]);
+        }
+    }
+    return mZOrderConfig;
+}
+
+uint64_t HwcLayerList::getLayerBytes(uint32_t layers) const
+{
+    uint64_t bytes = 0;
+    while (layers) {
+        int i = __builtin_ctz(layers);
+        layers &= ~(1U << i);
+        const hwc_rect_t& frame = mList->hwLayers[i].displayFrame;
+        uint64_t area = (uint64_t)(frame.right - frame.left) *
+                        (uint64_t)(frame.bottom - frame.top);
+        bytes += (area * mLayers.itemAt(i)->getBpp()) >> 3;
+    }
+    return bytes;
+}
+
+uint64_t HwcLayerList::getCompositionCost(uint32_t merged,
+                                          uint32_t planes,
+                                          uint32_t updated) const
+{
+    // memory traffic per frame: each plane reads its layer and frame buffer
+    // target reads the whole screen. When a layer merged to frame buffer
+    // target is updated, GPU also reads all merged layers and writes the
+    // target again
+    uint64_t cost = getLayerBytes(planes);
+    if (merged == 0) {
+        return cost;
+    }
+
+    uint64_t screen = (uint64_t)(mBounds.right - mBounds.left) *
+                      (uint64_t)(mBounds.bottom - mBounds.top);
+    if (screen == 0) {
+        const hwc_rect_t& frame = mList->hwLayers[mLayerCount - 1].displayFrame;
+        screen = (uint64_t)(frame.right - frame.left) *
+                 (uint64_t)(frame.bottom - frame.top);
+    }
+    screen *= SC2_TARGET_BYTES_PER_PIXEL;
+
+    cost += screen;
+    if (merged & updated) {
+        cost += getLayerBytes(merged) + screen;
+    }
+    return cost;
 }
 
 void HwcLayerList::setupSmartComposition()
@@ -762,9 +1894,7 @@ bool HwcLayerList::setupSmartComposition2()
         // exit criteria: once either static layer has update
         for (i = 0; i < mStaticLayersIndex.size(); i++) {
             layerIndex = mStaticLayersIndex.itemAt(i);
-            hwcLayer = mLayers.itemAt(layerIndex);
-
-            if (hwcLayer->isUpdated()) {
+            if (mLayers.itemAt(layerIndex)->isUpdated()) {
                 ret = true;
             }
         }
@@ -778,70 +1908,332 @@ bool HwcLayerList::setupSmartComposition2()
             }
 
             DTRACE("Exit Smart Composition2 !");
-            mLayerSize = 0;
             mStaticLayersIndex.clear();
+            mSc2Exits++;
         }
-    } else {
-        // entry criteria: hwc layers has no update
-        if (mFBLayers.size() == 0) {
-            for (i = 0; i < mLayerCount - 1; i++) {
-                hwcLayer = mLayers.itemAt(i);
-                if (hwcLayer->getPlane() &&
-                    hwcLayer->getCompositionType() == HWC_OVERLAY &&
-                    hwcLayer->getStaticCount() >= LAYER_STATIC_THRESHOLD) {
-                    mStaticLayersIndex.add(i);
-                }
-            }
+        return ret;
+    }
 
-            // check if all static layers in sequence
-            // if all in sequence, set FORCE_FB for static layers
-            // TODO: optimization here
-            //    1. If two connected, can trigger smart composition2
-            //    2. Caculate layer size to see if it saves more bandwidth
-            //    3. Dynamically check and add new static layers
-            int staticLayerCount = mStaticLayersIndex.size();
+    // layer bitmaps and the overlap matrix cover at most 32 layers
+    if (!mOverlap.isValid()) {
+        return ret;
+    }
 
-            if (staticLayerCount > 1 && staticLayerCount < mLayerCount-1) {
-                layerIndex = mStaticLayersIndex.itemAt(0);
-                hwcLayer = mLayers.itemAt(layerIndex);
-                mLayerSize = 0;
-                addStaticLayerSize(hwcLayer);
-                int preIndex = hwcLayer->getIndex();
-
-                for (i = 1; i < staticLayerCount; i++) {
-                    layerIndex = mStaticLayersIndex.itemAt(i);
-                    hwcLayer = mLayers.itemAt(layerIndex);
-                    int index = hwcLayer->getIndex();
-
-                    if (index == preIndex + 1) {
-                        addStaticLayerSize(hwcLayer);
-                        preIndex = index;
-                    } else
-                        break;
-                }
+    // entry criteria: static layers on planes. They are grouped into runs of
+    // adjacent layers, each run can be frozen in frame buffer target on its
+    // own, dynamic layers in between stay on their planes
+    uint32_t staticMask = 0;
+    uint32_t planeMask = 0;
+    uint32_t fbMask = 0;
+    uint32_t updatedMask = 0;
+    for (i = 0; i < (int)mFBLayers.size(); i++) {
+        hwcLayer = mFBLayers.itemAt(i);
+        uint32_t bit = 1U << hwcLayer->getIndex();
+        fbMask |= bit;
+        if (hwcLayer->isUpdated()) {
+            updatedMask |= bit;
+        }
+    }
+    for (i = 0; i < mLayerCount - 1; i++) {
+        hwcLayer = mLayers.itemAt(i);
+        uint32_t bit = 1U << i;
+        if (!(fbMask & bit) && hwcLayer->getPlane()) {
+            planeMask |= bit;
+            // cache buffer is composed already, protected video can not
+            // be composed by GPU
+            if (hwcLayer->getCompositionType() == HWC_OVERLAY &&
+                hwcLayer->getStaticCount() >= LAYER_STATIC_THRESHOLD &&
+                !hwcLayer->getCacheBuffer() &&
+                !hwcLayer->isProtected()) {
+                staticMask |= bit;
+            }
+        }
+    }
 
-                if ((i == staticLayerCount) && checkStaticLayerSize()) {
-                    for (i =0; i < staticLayerCount; i++) {
-                        layerIndex = mStaticLayersIndex.itemAt(i);
-                        hwcLayer = mLayers.itemAt(layerIndex);
-                        hwcLayer->setCompositionType(HWC_FORCE_FRAMEBUFFER);
-                    }
-                    DTRACE("In Smart Composition2 !");
-                    ret = true;
-                } else {
-                    mLayerSize = 0;
-                }
+    uint32_t runs[SC2_MAX_RUNS];
+    int runCount = 0;
+    uint32_t mask = staticMask;
+    while (mask && runCount < SC2_MAX_RUNS) {
+        // lowest run of adjacent set bits
+        uint32_t low = mask & (~mask + 1);
+        uint32_t run = mask & ~(mask + low);
+        runs[runCount++] = run;
+        mask &= ~run;
+    }
+    if (runCount == 0) {
+        return ret;
+    }
+
+    // pick the set of runs with the lowest memory traffic per frame among
+    // those that can be merged at a single Z order of frame buffer target
+    uint64_t baseline = getCompositionCost(fbMask, planeMask, updatedMask);
+    uint64_t best = baseline;
+    uint32_t bestFrozen = 0;
+    int bestTarget = -1;
+    int bestRuns = 0;
+    for (uint32_t set = 1; set < (1U << runCount); set++) {
+        uint32_t frozen = 0;
+        for (int j = 0; j < runCount; j++) {
+            if (set & (1U << j)) {
+                frozen |= runs[j];
             }
+        }
+
+        uint32_t merged = fbMask | frozen;
+        uint32_t planes = planeMask & ~frozen;
+        uint64_t cost = getCompositionCost(merged, planes, updatedMask);
+        if (cost >= best) {
+            continue;
+        }
+        int target = mOverlap.findMergeTarget(merged, planes);
+        if (target < 0) {
+            continue;
+        }
+        best = cost;
+        bestFrozen = frozen;
+        bestTarget = target;
+        bestRuns = __builtin_popcount(set);
+    }
 
-            if (!ret)
-                mStaticLayersIndex.clear();
+    if (bestFrozen == 0) {
+        return ret;
+    }
+
+    // the fallback to frame buffer re-allocates planes, it applies this
+    // layout instead of searching again: layers left on planes keep their
+    // plane type and frame buffer target takes the Z order picked above
+    uint32_t planes = planeMask & ~bestFrozen;
+    if (__builtin_popcount(planes) + 1 > PlaneAssignmentCache::MAX_ASSIGNMENTS) {
+        return ret;
+    }
+    PlaneAssignmentCache::Solution& solution = mSc2Solution;
+    solution.count = 0;
+    for (i = 0; i < mLayerCount - 1; i++) {
+        if (!(planes & (1U << i))) {
+            continue;
+        }
+        hwcLayer = mLayers.itemAt(i);
+        int planeType = hwcLayer->getPlane()->getType();
+        if (planeType == DisplayPlane::PLANE_PRIMARY) {
+            // primary plane is taken back by frame buffer target
+            planeType = DisplayPlane::PLANE_SPRITE;
+        }
+        PlaneAssignmentCache::Assignment& a = solution.assignments[solution.count++];
+        a.layerIndex = i;
+        a.planeType = planeType;
+        a.zorder = hwcLayer->getZOrder();
+    }
+    PlaneAssignmentCache::Assignment& target = solution.assignments[solution.count++];
+    target.layerIndex = mLayerCount - 1;
+    target.planeType = DisplayPlane::PLANE_PRIMARY;
+    target.zorder = mLayers.itemAt(bestTarget)->getZOrder();
+
+    mStaticLayersIndex.setCapacity(mLayerCount);
+    for (i = 0; i < mLayerCount - 1; i++) {
+        if (bestFrozen & (1U << i)) {
+            mStaticLayersIndex.add(i);
+            mLayers.itemAt(i)->setCompositionType(HWC_FORCE_FRAMEBUFFER);
         }
     }
 
+    DTRACE("In Smart Composition2 ! %d runs, %u bytes per frame saved",
+           bestRuns, (uint32_t)(baseline - best));
+    mSc2Entries++;
+    mSc2FrozenRuns += bestRuns;
+    mSc2SavedBytes = baseline - best;
+    ret = true;
+
     // return ture to trigger remap layers with HW plane
     return ret;
 }
 
+bool HwcLayerList::isCacheable(int index, uint32_t format, bool blending) const
+{
+    HwcLayer *hwcLayer = mLayers.itemAt(index);
+    uint32_t type = hwcLayer->getType();
+    if (type != HwcLayer::LAYER_FB && type != HwcLayer::LAYER_OVERLAY) {
+        return false;
+    }
+
+    // blit copies pixels as they are, layers must be opaque and unscaled
+    const hwc_layer_1_t& layer = mList->hwLayers[index];
+    if (!layer.handle ||
+        (layer.flags & HWC_SKIP_LAYER) ||
+        (!blending && layer.blending != HWC_BLENDING_NONE) ||
+        layer.planeAlpha != 0xff ||
+        layer.transform != 0 ||
+        hwcLayer->isUpdated() ||
+        hwcLayer->getStaticCount() < LAYER_STATIC_THRESHOLD ||
+        hwcLayer->getFormat() != format ||
+        DisplayQuery::isVideoFormat(format) ||
+        hwcLayer->isProtected()) {
+        return false;
+    }
+
+    const hwc_rect_t& frame = layer.displayFrame;
+    const hwc_frect_t& crop = layer.sourceCropf;
+    return crop.left == 0 && crop.top == 0 &&
+           (int)crop.right == frame.right - frame.left &&
+           (int)crop.bottom == frame.bottom - frame.top;
+}
+
+int HwcLayerList::findCacheGroup(int *indexes, bool blending)
+{
+    // visible layers other than frame buffer target
+    uint32_t visible = 0;
+    for (int i = 0; i < mLayerCount - 1; i++) {
+        if (mLayers.itemAt(i)->getType() != HwcLayer::LAYER_SKIPPED) {
+            visible |= 1U << i;
+        }
+    }
+
+    // every layer of a group is inside its bottom layer, layers above the
+    // bottom one are merged to its Z order so no other visible layer in
+    // between can overlap them. Pick the group that hides the most bytes
+    uint32_t bestGroup = 0;
+    uint64_t bestBytes = 0;
+    for (int base = 0; base < mLayerCount - 1; base++) {
+        HwcLayer *hwcLayer = mLayers.itemAt(base);
+        uint32_t format = hwcLayer->getFormat();
+        const hwc_rect_t& bounds = mList->hwLayers[base].displayFrame;
+        if (hwcLayer->isClipped() || !isCacheable(base, format, blending)) {
+            continue;
+        }
+
+        uint32_t group = 1U << base;
+        int count = 1;
+        for (int i = base + 1; i < mLayerCount - 1 &&
+             count < StaticLayerCache::MAX_LAYERS; i++) {
+            uint32_t bit = 1U << i;
+            const hwc_rect_t& frame = mList->hwLayers[i].displayFrame;
+            if (frame.left < bounds.left ||
+                frame.top < bounds.top ||
+                frame.right > bounds.right ||
+                frame.bottom > bounds.bottom ||
+                !isCacheable(i, format, blending) ||
+                !mOverlap.canMerge(bit, visible & ~(group | bit), base)) {
+                continue;
+            }
+            group |= bit;
+            count++;
+        }
+        if (count < 2) {
+            continue;
+        }
+
+        uint64_t bytes = getLayerBytes(group & ~(1U << base));
+        if (bytes > bestBytes) {
+            bestBytes = bytes;
+            bestGroup = group;
+        }
+    }
+
+    int count = 0;
+    while (bestGroup) {
+        int i = __builtin_ctz(bestGroup);
+        bestGroup &= ~(1U << i);
+        indexes[count++] = i;
+    }
+    return count;
+}
+
+bool HwcLayerList::setupLayerCache()
+{
+    if (mLayerCache.isPending()) {
+        // layers must stay unchanged until the blits queued at set finish
+        bool valid = mLayerCache.matches(mList);
+        for (int i = 0; valid && i < mLayerCount - 1; i++) {
+            if (mLayerCache.contains(i) && mLayers.itemAt(i)->isUpdated()) {
+                valid = false;
+            }
+        }
+        if (!valid) {
+            DTRACE("pending static layer cache invalidated");
+            mLayerCache.invalidate();
+            return false;
+        }
+        if (!mLayerCache.poll()) {
+            if (!mLayerCache.isPending()) {
+                mLayerCacheBackoff = LAYER_STATIC_THRESHOLD;
+            }
+            return false;
+        }
+
+        DTRACE("static layer cache is ready on layer %d",
+               mLayerCache.getBaseIndex());
+        // return true to trigger remap layers with HW plane
+        return true;
+    }
+
+    if (mLayerCache.isValid()) {
+        // cache buffer must still be scanned out and its layers unchanged
+        int base = mLayerCache.getBaseIndex();
+        bool valid = mLayerCache.matches(mList) &&
+                     mLayers.itemAt(base)->getPlane() != NULL;
+        for (int i = 0; valid && i < mLayerCount - 1; i++) {
+            if (mLayerCache.contains(i) && mLayers.itemAt(i)->isUpdated()) {
+                valid = false;
+            }
+        }
+        if (valid) {
+            mLayerCache.countHit();
+            return false;
+        }
+
+        DTRACE("static layer cache invalidated");
+        mLayerCache.invalidate();
+        return true;
+    }
+
+    if (mLayerCacheBackoff > 0) {
+        mLayerCacheBackoff--;
+        return false;
+    }
+
+    // smart composition 2 owns static layers while it is active
+    if (!mLayerCacheEnabled || !mOverlap.isValid() ||
+        mStaticLayersIndex.size() > 0 ||
+        (mList->flags & HWC_GEOMETRY_CHANGED)) {
+        return false;
+    }
+
+    int indexes[StaticLayerCache::MAX_LAYERS];
+    int count = findCacheGroup(indexes, false);
+    if (count < 2) {
+        // blit cannot blend, count the groups lost to blended layers
+        int blended[StaticLayerCache::MAX_LAYERS];
+        mLayerCache.countSearch(findCacheGroup(blended, true) >= 2);
+        return false;
+    }
+    mLayerCache.countSearch(false);
+
+    int base = indexes[0];
+    HwcLayer *baseLayer = mLayers.itemAt(base);
+    if (!mLayerCache.build(mList, indexes, count,
+                           baseLayer->getFormat(), baseLayer->getBpp())) {
+        mLayerCacheBackoff = LAYER_STATIC_THRESHOLD;
+        return false;
+    }
+
+    // layers are remapped once the blits queued at set have finished
+    DTRACE("%d static layers to cache on layer %d", count, base);
+    return false;
+}
+
+void HwcLayerList::commitLayerCache(hwc_display_contents_1_t *list)
+{
+    if (mLayerCache.isPending()) {
+        mLayerCache.queueBlits(list);
+    }
+}
+
+void HwcLayerList::cancelLayerCache()
+{
+    if (mLayerCache.isPending() && !mLayerCache.isQueued()) {
+        mLayerCache.invalidate();
+    }
+}
+
 #if 1  // support overlay fallback to GLES
 
 bool HwcLayerList::update(hwc_display_contents_1_t *list)
@@ -863,6 +2255,7 @@ bool HwcLayerList::update(hwc_display_contents_1_t *list)
     mList = list;
 
     bool ok = true;
+    HwcLayerVector failedLayers;
     // update all layers, call each layer's update()
     for (int i = 0; i < mLayerCount; i++) {
         HwcLayer *hwcLayer = mLayers.itemAt(i);
@@ -873,11 +2266,34 @@ bool HwcLayerList::update(hwc_display_contents_1_t *list)
 
         if (!hwcLayer->update(&list->hwLayers[i])) {
             ok = false;
-            hwcLayer->setCompositionType(HWC_FORCE_FRAMEBUFFER);
+            failedLayers.add(hwcLayer);
+        }
+
+        // geometry change kept by the device, composition types are reset
+        // by SurfaceFlinger and need to be marked again
+        if (list->flags & HWC_GEOMETRY_CHANGED) {
+            hwcLayer->setType(hwcLayer->getType());
+        }
+    }
+
+    // try to compose failing layers by GPU without touching planes of
+    // other layers, fall back to full re-initialization if not possible
+    if (!ok) {
+        size_t demoted = 0;
+        while (demoted < failedLayers.size() && demoteLayer(failedLayers[demoted])) {
+            DTRACE("layer %d is demoted to frame buffer target",
+                failedLayers[demoted]->getIndex());
+            demoted++;
+        }
+        ok = (demoted == failedLayers.size());
+    }
+    if (!ok) {
+        for (size_t i = 0; i < failedLayers.size(); i++) {
+            failedLayers[i]->setCompositionType(HWC_FORCE_FRAMEBUFFER);
         }
     }
 
-    if (!ok || setupSmartComposition2()) {
+    if (!ok || setupLayerCache() || setupSmartComposition2()) {
         ITRACE("overlay fallback to GLES. flags: %#x", list->flags);
         for (int i = 0; i < mLayerCount - 1; i++) {
             HwcLayer *hwcLayer = mLayers.itemAt(i);
@@ -888,9 +2304,12 @@ bool HwcLayerList::update(hwc_display_contents_1_t *list)
             }
         }
         mLayers.itemAt(mLayerCount - 1)->setCompositionType(HWC_FRAMEBUFFER_TARGET);
-        deinitialize();
-        mList = list;
-        initialize();
+
+        // layers are reused by reset, this frame is already in their
+        // update history and loading the same list must not count it again
+        freezeHistory(true);
+        reset(list);
+        freezeHistory(true);
 
         // update all layers again after plane re-allocation
         for (int i = 0; i < mLayerCount; i++) {
@@ -904,8 +2323,13 @@ bool HwcLayerList::update(hwc_display_contents_1_t *list)
                 DTRACE("fallback to GLES update failed on layer[%d]!\n", i);
             }
         }
+        freezeHistory(false);
     }
 
+    mCulledAreaTotal += mCulledArea;
+    updateEligibility();
+    updateDamage();
+    updateVideoActivity();
     setupSmartComposition();
     return true;
 }
@@ -971,12 +2395,53 @@ DisplayPlane* HwcLayerList::getPlane(uint32_t index) const
     return hwcLayer->getPlane();
 }
 
+uint32_t HwcLayerList::getContentFrameRate(int *cadence)
+{
+    uint32_t rate = 0;
+    int bestCadence = CadenceTracker::CADENCE_UNKNOWN;
+    uint64_t bestArea = 0;
+
+    // frame buffer target only follows the layers composed into it
+    for (int i = 0; i < mLayerCount - 1; i++) {
+        HwcLayer *hwcLayer = mLayers.itemAt(i);
+        CadenceTracker& tracker = hwcLayer->getCadence();
+        uint32_t layerRate = tracker.getFrameRate();
+        if (layerRate == 0) {
+            continue;
+        }
+
+        const hwc_rect_t& frame = mList->hwLayers[i].displayFrame;
+        uint64_t area = (uint64_t)(frame.right - frame.left) *
+                        (uint64_t)(frame.bottom - frame.top);
+        if (area > bestArea) {
+            bestArea = area;
+            rate = layerRate;
+            bestCadence = tracker.getCadence();
+        }
+    }
+
+    if (cadence) {
+        *cadence = bestCadence;
+    }
+    return rate;
+}
+
 void HwcLayerList::postFlip()
 {
     for (size_t i = 0; i < mLayers.size(); i++) {
         HwcLayer *hwcLayer = mLayers.itemAt(i);
         hwcLayer->postFlip();
     }
+    mLayerCache.postFlip();
+}
+
+void HwcLayerList::skipFlip()
+{
+    // only the pacer moves on, it has recorded the deferred frame. Planes
+    // keep their update masks so that the buffers set in prepare are
+    // programmed when the frame is presented again, and retired cache
+    // buffers stay on screen until a flip actually replaces them
+    VTRACE("flip of device %d deferred", mDisplayIndex);
 }
 
 void HwcLayerList::dump(Dump& d)
@@ -1041,6 +2506,81 @@ void HwcLayerList::dump(Dump& d)
                      i, type, planeType, planeIndex, zorder);
         }
     }
+
+    d.append("Plane candidates ranked by bandwidth saving:\n");
+    d.append("   TYPE  | RANK | LAYER | KB/FRAME | UPDATE RATE | PRIORITY \n");
+    d.append("---------+------+-------+----------+-------------+----------\n");
+    dumpCandidates(d, "CURSOR", mCursorCandidates);
+    dumpCandidates(d, "OVERLAY", mOverlayCandidates);
+    dumpCandidates(d, "SPRITE", mSpriteCandidates);
+
+    uint32_t damaged = mScreenAreaTotal ?
+        (uint32_t)(mDamageAreaTotal * 100 / mScreenAreaTotal) : 0;
+    d.append("Frame buffer damage: (threshold %u%%)\n", mDamageThreshold);
+    d.append("  FRAMES  | AVG DAMAGE | PARTIAL  |  EMPTY   \n");
+    d.append("----------+------------+----------+----------\n");
+    d.append(" %8u |    %3u%%    | %8u | %8u \n",
+             mDamageFrames, damaged, mPartialDamageFrames,
+             mEmptyDamageFrames);
+
+    d.append("Smart composition 2: (%d static layers frozen)\n",
+             (int)mStaticLayersIndex.size());
+    d.append(" ENTRIES  |  EXITS   |   RUNS   | REJECTED | SAVED KB/FRAME \n");
+    d.append("----------+----------+----------+----------+----------------\n");
+    d.append(" %8u | %8u | %8u | %8u | %8u \n",
+             mSc2Entries, mSc2Exits, mSc2FrozenRuns, mSc2Rejected,
+             (uint32_t)(mSc2SavedBytes >> 10));
+
+    mLayerCache.dump(d);
+    mVideoPacer.dump(d);
+
+    d.append("Layer cadence:\n");
+    d.append(" LAYER |    FPS   | JITTER US |   CADENCE    \n");
+    d.append("-------+----------+-----------+--------------\n");
+    for (size_t i = 0; i < mLayers.size(); i++) {
+        CadenceTracker& tracker = mLayers.itemAt(i)->getCadence();
+        uint32_t fps = tracker.getFrameRate();
+        if (fps == 0) {
+            continue;
+        }
+        d.append("  %2d   | %5u.%02u | %9u | %12s \n",
+                 (int)i, fps / 100, fps % 100, tracker.getJitter(),
+                 CadenceTracker::getCadenceName(tracker.getCadence()));
+    }
+
+    d.append("Video: %s, %u repeated frames\n",
+             mVideoPaused ? "paused" : "not paused", mRepeatedVideoFrames);
+
+    d.append("Opportunistic cursor plane: %s\n",
+             mOpportunisticCursor ? "enabled" : "disabled");
+
+    d.append("Culled layers: %d, culled area %u pixels per frame, %llu pixels in total\n",
+             mCulledLayers, mCulledArea, (unsigned long long)mCulledAreaTotal);
+
+    d.append("Composition path hysteresis: (sprite %u, overlay %u, cursor %u frames)\n",
+             mHysteresis[DisplayPlane::PLANE_SPRITE],
+             mHysteresis[DisplayPlane::PLANE_OVERLAY],
+             mHysteresis[DisplayPlane::PLANE_CURSOR]);
+    d.append(" LAYER | ELIGIBLE FRAMES | TRANSITIONS | HELD BACK \n");
+    d.append("-------+-----------------+-------------+-----------\n");
+    for (int i = 0; i < mLayerCount - 1; i++) {
+        HwcLayer *hwcLayer = mLayers.itemAt(i);
+        d.append("  %2d   |      %4u       |   %8u  |    %3s \n",
+                 i, hwcLayer->getEligibleFrames(), hwcLayer->getTransitions(),
+                 hwcLayer->isHeldBack() ? "yes" : "no");
+    }
+}
+
+void HwcLayerList::dumpCandidates(Dump& d, const char *name, PriorityVector& candidates)
+{
+    for (size_t i = 0; i < candidates.size(); i++) {
+        HwcLayer *hwcLayer = candidates.itemAt(i);
+        d.append(" %7s |  %2d  |  %2d   | %8u |    %3u%%     | %08x \n",
+                 name, i, hwcLayer->getIndex(),
+                 hwcLayer->getBandwidth() >> 10,
+                 hwcLayer->getUpdateRate() * 100 / HwcLayer::LAYER_UPDATE_RATE_ONE,
+                 hwcLayer->getPriority());
+    }
 }
 
 
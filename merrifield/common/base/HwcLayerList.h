@@ -23,6 +23,10 @@
 #include <DisplayPlane.h>
 #include <DisplayPlaneManager.h>
 #include <HwcLayer.h>
+#include <OverlapMatrix.h>
+#include <PlaneAssignmentCache.h>
+#include <StaticLayerCache.h>
+#include <VideoPacer.h>
 
 namespace android {
 namespace intel {
@@ -36,11 +40,32 @@ public:
 public:
     virtual bool initialize();
     virtual void deinitialize();
+    // re-initialize with the list of a geometry change, layers of the
+    // previous list are reused when they match the new ones
+    virtual bool reset(hwc_display_contents_1_t *list);
 
     virtual bool update(hwc_display_contents_1_t *list);
     virtual DisplayPlane* getPlane(uint32_t index) const;
+    // true if the plane assignment can be kept across a geometry change
+    // whose layers are identical to the current ones
+    bool isAssignmentReusable() const;
+    // frame rate in 1/100 fps of the largest layer whose content is moving,
+    // its cadence is returned if requested. 0 if no content is moving
+    uint32_t getContentFrameRate(int *cadence = NULL);
+    // called before the contents are committed, true if a video frame is
+    // early on the vsync timeline and nothing else is updated. The contents
+    // are then not committed and are presented again after the next vsync
+    bool paceVideo();
+    // called at set, queues the blits of a static layer cache built in
+    // prepare behind the acquire fences of the list
+    void commitLayerCache(hwc_display_contents_1_t *list);
+    // called at set when the contents are not committed, a cache whose
+    // blits could not be queued is dropped instead of staying pending
+    void cancelLayerCache();
 
     void postFlip();
+    // called instead of postFlip when paceVideo deferred the contents
+    void skipFlip();
 
     // dump interface
     virtual void dump(Dump& d);
@@ -48,7 +73,31 @@ public:
 private:
     bool checkSupported(int planeType, HwcLayer *hwcLayer);
     bool checkCursorSupported(HwcLayer *hwcLayer);
+    bool checkOpportunisticCursor(HwcLayer *hwcLayer);
+    bool checkRgbOverlaySupported(HwcLayer *hwcLayer);
+    bool checkCapabilities(int planeType, HwcLayer *hwcLayer);
+    bool checkCursorCapabilities(HwcLayer *hwcLayer);
+    int getCandidateType(HwcLayer *hwcLayer);
+    bool isSettled(HwcLayer *hwcLayer, int planeType);
+    void updateEligibility();
+    HwcLayer* reuseLayer(int index, hwc_layer_1_t *layer);
+    void freezeHistory(bool frozen);
+    void releaseRetiredLayers();
+    void publishPlaneDemand(int planeType, PriorityVector& candidates);
+    void cullLayers();
+    void updateDisplayBounds();
+    void updateDamage();
+    bool isOpaque(hwc_layer_1_t *layer);
+    void updateVideoActivity();
+    void setVideoPaused(bool paused);
+    uint32_t getVisibleArea(HwcLayer *hwcLayer);
     bool allocatePlanes();
+    bool solvePlanes();
+    void solvePlanes(int index, int cost, int gain);
+    void solveLeaf(int cost);
+    bool testZOrderConfig();
+    bool buildSignature(PlaneAssignmentCache::Signature& sig);
+    bool applySolution(const PlaneAssignmentCache::Solution& solution);
     bool assignCursorPlanes();
     bool assignCursorPlanes(int index, int planeNumber);
     bool assignOverlayPlanes();
@@ -59,16 +108,89 @@ private:
     bool assignPrimaryPlaneHelper(HwcLayer *hwcLayer, int zorder = -1);
     bool attachPlanes();
     bool useAsFrameBufferTarget(HwcLayer *target);
+    bool useAsFrameBufferTargetSlow(HwcLayer *target);
     bool hasIntersection(HwcLayer *la, HwcLayer *lb);
-    void addStaticLayerSize(HwcLayer *hwcLayer);
-    bool checkStaticLayerSize();
+    bool demoteLayer(HwcLayer *hwcLayer);
+    uint64_t getLayerBytes(uint32_t layers) const;
+    uint64_t getCompositionCost(uint32_t merged, uint32_t planes, uint32_t updated) const;
     ZOrderLayer* addZOrderLayer(int type, HwcLayer *hwcLayer, int zorder = -1);
     void removeZOrderLayer(ZOrderLayer *layer);
+    void clearZOrderLayers();
+    int getZOrderLayerCount() const;
+    int getZOrderSlot(HwcLayer *hwcLayer) const;
+    ZOrderConfig& buildZOrderConfig();
     void setupSmartComposition();
     bool setupSmartComposition2();
+    // blended layers are accepted if blending is set, blit cannot blend
+    // them and such groups are only counted
+    bool isCacheable(int index, uint32_t format, bool blending) const;
+    int findCacheGroup(int *indexes, bool blending);
+    bool setupLayerCache();
     void dump();
 
 private:
+    enum {
+        // ZOrderLayer arena is indexed by layer index, frame buffer target
+        // always takes the last slot
+        MAX_ZORDER_LAYERS = ZOrderConfig::MAX_LAYERS,
+        FRAMEBUFFER_TARGET_SLOT = MAX_ZORDER_LAYERS - 1,
+    };
+
+    enum {
+        // greedy cursor -> overlay -> sprite -> primary recursion
+        SOLVER_GREEDY = 0,
+        // branch and bound search minimizing GPU composited area
+        SOLVER_MIN_COST,
+    };
+
+    enum {
+        // frames a layer must stay eligible before it moves back to a plane
+        HYSTERESIS_SPRITE_FRAMES = 3,
+        HYSTERESIS_OVERLAY_FRAMES = 3,
+        HYSTERESIS_CURSOR_FRAMES = 0,
+    };
+
+    enum {
+        // damage under this percentage of the screen counts as partial
+        DAMAGE_DEFAULT_THRESHOLD = 25,
+    };
+
+    enum {
+        // square sizes the cursor plane can scan out
+        CURSOR_SIZE_SMALL = 64,
+        CURSOR_SIZE_MEDIUM = 128,
+        CURSOR_SIZE_LARGE = 256,
+        CURSOR_POSITION_MAX = 4096,
+    };
+
+    enum {
+        // runs of adjacent static layers considered by smart composition 2
+        SC2_MAX_RUNS = 8,
+        SC2_TARGET_BYTES_PER_PIXEL = 4,
+    };
+
+    enum {
+        SOLVER_MAX_CANDIDATES = 16,
+        SOLVER_DEFAULT_BUDGET = 512,
+    };
+
+    // search state of the min cost solver
+    struct SolverCandidate {
+        HwcLayer *hwcLayer;
+        int planeType;
+        int area;
+    };
+
+    struct SolverState {
+        SolverCandidate candidates[SOLVER_MAX_CANDIDATES];
+        int candidateCount;
+        int freePlanes[DisplayPlane::PLANE_MAX];
+        int nodes;
+        int budget;
+        int bestCost;
+        PlaneAssignmentCache::Solution best;
+    };
+
     class HwcLayerVector : public SortedVector<HwcLayer*> {
     public:
         HwcLayerVector() {}
@@ -90,19 +212,77 @@ private:
         }
     };
 
+    void dumpCandidates(Dump& d, const char *name, PriorityVector& candidates);
+
     hwc_display_contents_1_t *mList;
     int mLayerCount;
 
     HwcLayerVector mLayers;
+    // layers of the previous list waiting to be matched by the next one
+    Vector<HwcLayer*> mRetiredLayers;
+    HwcLayer *mRetiredTarget;
     HwcLayerVector mFBLayers;
     Vector<int> mStaticLayersIndex;
     PriorityVector mSpriteCandidates;
     PriorityVector mOverlayCandidates;
     PriorityVector mCursorCandidates;
+    // arena of Z order layers, membership is tracked by mZOrderMask and
+    // mZOrderConfig is only built when a config is validated or attached
+    ZOrderLayer mZOrderLayers[MAX_ZORDER_LAYERS];
+    uint32_t mZOrderMask;
     ZOrderConfig mZOrderConfig;
+    // display frame overlap relation, built with the layer table
+    OverlapMatrix mOverlap;
+    // last Z order config attached, recorded for the plane assignment cache
+    PlaneAssignmentCache::Solution mSolution;
     HwcLayer *mFrameBufferTarget;
+    // Z order of frame buffer target in the attached config, -1 if none
+    int mTargetZOrder;
     int mDisplayIndex;
-    int mLayerSize;
+    int mSolverMode;
+    SolverState mSolver;
+    // eligible frames required per plane type before promotion
+    uint32_t mHysteresis[DisplayPlane::PLANE_MAX];
+    // small top-most layers may use the cursor plane when it is idle
+    bool mOpportunisticCursor;
+    // area of the current display mode, empty if unknown
+    hwc_rect_t mBounds;
+    // pixels of display frames left visible by the screen and opaque
+    // layers above, by layer index
+    uint32_t mVisibleAreas[MAX_ZORDER_LAYERS];
+    // culling statistics
+    int mCulledLayers;
+    uint32_t mCulledArea;
+    uint64_t mCulledAreaTotal;
+    // union of updated frame buffer layers in the current frame, only
+    // measured: every attached plane is still flipped each frame
+    hwc_rect_t mDamage;
+    uint32_t mDamageThreshold;
+    // damage statistics
+    uint32_t mDamageFrames;
+    uint32_t mPartialDamageFrames;
+    uint32_t mEmptyDamageFrames;
+    uint64_t mDamageAreaTotal;
+    uint64_t mScreenAreaTotal;
+    // video layers presenting a repeated frame, all of them paused
+    uint32_t mRepeatedVideoFrames;
+    bool mVideoPaused;
+    // smart composition 2 statistics
+    uint32_t mSc2Entries;
+    uint32_t mSc2Exits;
+    uint32_t mSc2FrozenRuns;
+    uint64_t mSc2SavedBytes;
+    // planned layouts the plane manager did not accept
+    uint32_t mSc2Rejected;
+    // plane layout to apply when the frozen layers go to frame buffer
+    PlaneAssignmentCache::Solution mSc2Solution;
+    // static layers flattened by HWC, frames to wait after a failed build
+    StaticLayerCache mLayerCache;
+    bool mLayerCacheEnabled;
+    uint32_t mLayerCacheBackoff;
+    // presentation of video frames on the vsync timeline
+    VideoPacer mVideoPacer;
+    bool mVideoPacing;
 };
 
 } // namespace intel
@@ -29,11 +29,13 @@ Hwcomposer::Hwcomposer(IPlatFactory *factory)
       mPlatFactory(factory),
       mVsyncManager(0),
       mDisplayAnalyzer(0),
+      mPlaneAssignmentCache(0),
       mMultiDisplayObserver(0),
       mUeventObserver(0),
       mPlaneManager(0),
       mBufferManager(0),
       mDisplayContext(0),
+      mVideoPayloadManager(0),
       mInitialized(false)
 {
     CTRACE();
@@ -105,6 +107,12 @@ bool Hwcomposer::prepare(size_t numDisplays,
         }
     }
 
+    // split shared planes between displays by their candidates, the new
+    // split takes effect at the next geometry change
+    if (mPlaneManager->balancePlanes()) {
+        mDisplayAnalyzer->postPlaneAllocationEvent();
+    }
+
     return ret;
 }
 
@@ -330,6 +338,8 @@ void Hwcomposer::vsync(int disp, int64_t timestamp)
 {
     RETURN_VOID_IF_NOT_INIT();
 
+    mVsyncManager->onVsync(disp, timestamp);
+
     if (mProcs && mProcs->vsync) {
         VTRACE("report vsync on disp %d, timestamp %llu", disp, timestamp);
         // workaround to pretend vsync is from primary display
@@ -395,6 +405,14 @@ bool Hwcomposer::dump(char *buff, int buff_len, int *cur_len)
     if (mBufferManager)
         mBufferManager->dump(d);
 
+    // dump plane assignment cache status
+    if (mPlaneAssignmentCache)
+        mPlaneAssignmentCache->dump(d);
+
+    // dump display analyzer status
+    if (mDisplayAnalyzer)
+        mDisplayAnalyzer->dump(d);
+
     return true;
 }
 
@@ -439,6 +457,11 @@ bool Hwcomposer::initialize()
         DEINIT_AND_RETURN_FALSE("failed to create display context");
     }
 
+    mVideoPayloadManager = mPlatFactory->createVideoPayloadManager();
+    if (!mVideoPayloadManager) {
+        DEINIT_AND_RETURN_FALSE("failed to create video payload manager");
+    }
+
     mUeventObserver = new UeventObserver();
     if (!mUeventObserver || !mUeventObserver->initialize()) {
         DEINIT_AND_RETURN_FALSE("failed to initialize uevent observer");
@@ -467,6 +490,11 @@ bool Hwcomposer::initialize()
         DEINIT_AND_RETURN_FALSE("failed to initialize display analyzer");
     }
 
+    mPlaneAssignmentCache = new PlaneAssignmentCache();
+    if (!mPlaneAssignmentCache || !mPlaneAssignmentCache->initialize()) {
+        DEINIT_AND_RETURN_FALSE("failed to initialize plane assignment cache");
+    }
+
     mMultiDisplayObserver = new MultiDisplayObserver();
     if (!mMultiDisplayObserver || !mMultiDisplayObserver->initialize()) {
         DEINIT_AND_RETURN_FALSE("failed to initialize display observer");
@@ -482,6 +510,7 @@ bool Hwcomposer::initialize()
 void Hwcomposer::deinitialize()
 {
     DEINIT_AND_DELETE_OBJ(mMultiDisplayObserver);
+    DEINIT_AND_DELETE_OBJ(mPlaneAssignmentCache);
     DEINIT_AND_DELETE_OBJ(mDisplayAnalyzer);
     // delete mVsyncManager first as it holds reference to display devices.
     DEINIT_AND_DELETE_OBJ(mVsyncManager);
@@ -494,6 +523,11 @@ void Hwcomposer::deinitialize()
     }
     mDisplayDevices.clear();
 
+    if (mVideoPayloadManager) {
+        delete mVideoPayloadManager;
+        mVideoPayloadManager = 0;
+    }
+
     if (mPlatFactory) {
         delete mPlatFactory;
         mPlatFactory = 0;
@@ -526,11 +560,21 @@ IDisplayContext* Hwcomposer::getDisplayContext()
     return mDisplayContext;
 }
 
+IVideoPayloadManager* Hwcomposer::getVideoPayloadManager()
+{
+    return mVideoPayloadManager;
+}
+
 DisplayAnalyzer* Hwcomposer::getDisplayAnalyzer()
 {
     return mDisplayAnalyzer;
 }
 
+PlaneAssignmentCache* Hwcomposer::getPlaneAssignmentCache()
+{
+    return mPlaneAssignmentCache;
+}
+
 MultiDisplayObserver* Hwcomposer::getMultiDisplayObserver()
 {
     return mMultiDisplayObserver;
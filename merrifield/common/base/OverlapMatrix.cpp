@@ -0,0 +1,100 @@
+/*
+// Copyright (c) 2014 Intel Corporation 
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+#include <HwcTrace.h>
+#include <OverlapMatrix.h>
+
+namespace android {
+namespace intel {
+
+OverlapMatrix::OverlapMatrix()
+    : mValid(false)
+{
+    memset(mRows, 0, sizeof(mRows));
+}
+
+bool OverlapMatrix::build(hwc_display_contents_1_t *list)
+{
+    int count = (int)list->numHwLayers;
+    mValid = (count <= MAX_LAYERS);
+    if (!mValid) {
+        VTRACE("too many layers (%d) for overlap matrix", count);
+        return false;
+    }
+
+    int32_t left[MAX_LAYERS];
+    int32_t top[MAX_LAYERS];
+    int32_t right[MAX_LAYERS];
+    int32_t bottom[MAX_LAYERS];
+    for (int i = 0; i < count; i++) {
+        const hwc_rect_t& frame = list->hwLayers[i].displayFrame;
+        left[i] = frame.left;
+        top[i] = frame.top;
+        right[i] = frame.right;
+        bottom[i] = frame.bottom;
+    }
+
+    // branchless rectangle test over plain arrays so the inner loop can be
+    // vectorized, same condition as HwcLayerList::hasIntersection
+    for (int i = 0; i < count; i++) {
+        uint32_t row = 0;
+        for (int j = 0; j < count; j++) {
+            uint32_t hit = (uint32_t)(right[j] > left[i]) &
+                           (uint32_t)(left[j] < right[i]) &
+                           (uint32_t)(top[j] < bottom[i]) &
+                           (uint32_t)(bottom[j] > top[i]);
+            row |= hit << j;
+        }
+        mRows[i] = row & ~(1U << i);
+    }
+    return true;
+}
+
+bool OverlapMatrix::canMerge(uint32_t layers, uint32_t planes, int targetIndex) const
+{
+    // layers are moved to the Z order of the target layer, no plane layer
+    // they pass on the way can overlap them
+    uint32_t targetBit = 1U << targetIndex;
+    while (layers) {
+        int index = __builtin_ctz(layers);
+        uint32_t bit = 1U << index;
+        layers &= ~bit;
+
+        // layers strictly between the layer and the target
+        uint32_t between = (index < targetIndex) ?
+            (targetBit - (bit << 1)) : (bit - (targetBit << 1));
+        if (mRows[index] & planes & between) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int OverlapMatrix::findMergeTarget(uint32_t layers, uint32_t planes) const
+{
+    uint32_t mask = layers;
+    while (mask) {
+        int index = __builtin_ctz(mask);
+        mask &= ~(1U << index);
+        if (canMerge(layers & ~(1U << index), planes, index)) {
+            return index;
+        }
+    }
+    return -1;
+}
+
+} // namespace intel
+} // namespace android
@@ -0,0 +1,58 @@
+/*
+// Copyright (c) 2014 Intel Corporation 
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+#ifndef OVERLAP_MATRIX_H
+#define OVERLAP_MATRIX_H
+
+#include <hardware/hwcomposer.h>
+
+namespace android {
+namespace intel {
+
+// Display frame overlap relation of a layer list as a bit matrix, row i has
+// bit j set if layer i and layer j intersect. Z order questions about
+// moving layers to the frame buffer target become AND operations on rows.
+class OverlapMatrix {
+public:
+    enum {
+        MAX_LAYERS = 32,
+    };
+
+public:
+    OverlapMatrix();
+
+public:
+    // false if the list holds more layers than a row can describe
+    bool build(hwc_display_contents_1_t *list);
+    void invalidate() { mValid = false; }
+    bool isValid() const { return mValid; }
+    uint32_t row(int index) const { return mRows[index]; }
+
+    // true if layers can move to the Z order of the target layer without
+    // passing a plane layer they overlap, bitmaps are indexed by layer
+    bool canMerge(uint32_t layers, uint32_t planes, int targetIndex) const;
+    // lowest layer the others can be merged to, -1 if none
+    int findMergeTarget(uint32_t layers, uint32_t planes) const;
+
+private:
+    uint32_t mRows[MAX_LAYERS];
+    bool mValid;
+};
+
+} // namespace intel
+} // namespace android
+
+
+#endif /* OVERLAP_MATRIX_H */
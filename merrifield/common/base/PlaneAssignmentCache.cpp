@@ -0,0 +1,241 @@
+/*
+// Copyright (c) 2014 Intel Corporation 
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+#include <HwcTrace.h>
+#include <hardware/hwcomposer.h>
+#include <PlaneAssignmentCache.h>
+#include <Fnv1a.h>
+
+namespace android {
+namespace intel {
+
+void PlaneAssignmentCache::Signature::reset(int disp, int layerCount)
+{
+    hash = 0;
+    size = HEADER_WORDS;
+    words[0] = (uint32_t)disp;
+    words[1] = (uint32_t)layerCount;
+    for (int i = 0; i < DisplayPlane::PLANE_MAX; i++) {
+        words[2 + i] = 0;
+    }
+}
+
+void PlaneAssignmentCache::Signature::setFreePlanes(int type, uint32_t mask)
+{
+    if (type < 0 || type >= DisplayPlane::PLANE_MAX) {
+        return;
+    }
+    words[2 + type] = mask;
+}
+
+void PlaneAssignmentCache::Signature::addLayer(uint32_t format,
+                                               uint32_t attributes,
+                                               uint32_t overlap)
+{
+    if (size + LAYER_WORDS > MAX_WORDS) {
+        ETRACE("signature overflow");
+        return;
+    }
+    words[size++] = format;
+    words[size++] = attributes;
+    words[size++] = overlap;
+}
+
+void PlaneAssignmentCache::Signature::seal()
+{
+    Fnv1a h;
+    h.add(words, size);
+    hash = h.get();
+}
+
+bool PlaneAssignmentCache::Signature::operator==(const Signature& rhs) const
+{
+    if (hash != rhs.hash || size != rhs.size) {
+        return false;
+    }
+    return memcmp(words, rhs.words, size * sizeof(uint32_t)) == 0;
+}
+
+PlaneAssignmentCache::PlaneAssignmentCache()
+    : mInitialized(false),
+      mClock(0),
+      mLookups(0),
+      mHits(0),
+      mStaleHits(0),
+      mEvictions(0)
+{
+    memset(mEntries, 0, sizeof(mEntries));
+}
+
+PlaneAssignmentCache::~PlaneAssignmentCache()
+{
+    WARN_IF_NOT_DEINIT();
+}
+
+bool PlaneAssignmentCache::initialize()
+{
+    memset(mEntries, 0, sizeof(mEntries));
+    mClock = 0;
+    mInitialized = true;
+    return true;
+}
+
+void PlaneAssignmentCache::deinitialize()
+{
+    mInitialized = false;
+}
+
+uint32_t PlaneAssignmentCache::sizeClass(int size)
+{
+    // log2 bucket, 0 for empty or invalid sizes
+    if (size <= 0) {
+        return 0;
+    }
+    return 32 - __builtin_clz((uint32_t)size);
+}
+
+uint32_t PlaneAssignmentCache::packAttributes(int candidate,
+                                              uint32_t layerType,
+                                              uint32_t transform,
+                                              int32_t blending,
+                                              uint8_t planeAlpha,
+                                              int cropWidth,
+                                              int cropHeight,
+                                              int frameWidth,
+                                              int frameHeight)
+{
+    uint32_t blend;
+    switch (blending) {
+    case HWC_BLENDING_NONE:
+        blend = 0;
+        break;
+    case HWC_BLENDING_PREMULT:
+        blend = 1;
+        break;
+    case HWC_BLENDING_COVERAGE:
+        blend = 2;
+        break;
+    default:
+        blend = 3;
+        break;
+    }
+
+    // bits 0-1: candidate, 2-4: layer type, 5-7: transform, 8-9: blending,
+    // 10: opaque plane alpha, 11-30: size classes (5 bits each)
+    return ((uint32_t)candidate & 0x3) |
+           ((layerType & 0x7) << 2) |
+           ((transform & 0x7) << 5) |
+           (blend << 8) |
+           ((planeAlpha == 0xff ? 1 : 0) << 10) |
+           ((sizeClass(cropWidth) & 0x1f) << 11) |
+           ((sizeClass(cropHeight) & 0x1f) << 16) |
+           ((sizeClass(frameWidth) & 0x1f) << 21) |
+           ((sizeClass(frameHeight) & 0x1f) << 26);
+}
+
+int PlaneAssignmentCache::find(const Signature& sig)
+{
+    for (int i = 0; i < CACHE_SIZE; i++) {
+        if (mEntries[i].valid && mEntries[i].signature == sig) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool PlaneAssignmentCache::lookup(const Signature& sig, Solution& solution)
+{
+    RETURN_FALSE_IF_NOT_INIT();
+
+    mLookups++;
+    int i = find(sig);
+    if (i < 0) {
+        return false;
+    }
+
+    mHits++;
+    mEntries[i].lastUsed = ++mClock;
+    solution = mEntries[i].solution;
+    return true;
+}
+
+void PlaneAssignmentCache::insert(const Signature& sig, const Solution& solution)
+{
+    RETURN_VOID_IF_NOT_INIT();
+
+    if (solution.count < 0 || solution.count > MAX_ASSIGNMENTS) {
+        return;
+    }
+
+    int slot = find(sig);
+    if (slot < 0) {
+        // take an empty slot or evict the least recently used entry
+        slot = 0;
+        for (int i = 0; i < CACHE_SIZE; i++) {
+            if (!mEntries[i].valid) {
+                slot = i;
+                break;
+            }
+            if (mEntries[i].lastUsed < mEntries[slot].lastUsed) {
+                slot = i;
+            }
+        }
+        if (mEntries[slot].valid) {
+            mEvictions++;
+        }
+    }
+
+    Entry& entry = mEntries[slot];
+    entry.valid = true;
+    entry.lastUsed = ++mClock;
+    entry.signature = sig;
+    entry.solution = solution;
+}
+
+void PlaneAssignmentCache::invalidate(const Signature& sig)
+{
+    RETURN_VOID_IF_NOT_INIT();
+
+    int i = find(sig);
+    if (i >= 0) {
+        mEntries[i].valid = false;
+        mStaleHits++;
+        // a stale hit ends up running the full search
+        if (mHits > 0) {
+            mHits--;
+        }
+    }
+}
+
+void PlaneAssignmentCache::dump(Dump& d)
+{
+    int entries = 0;
+    for (int i = 0; i < CACHE_SIZE; i++) {
+        if (mEntries[i].valid) {
+            entries++;
+        }
+    }
+
+    uint32_t rate = mLookups ? (mHits * 100 / mLookups) : 0;
+
+    d.append("Plane Assignment Cache: (entries %d/%d)\n", entries, CACHE_SIZE);
+    d.append(" LOOKUPS  |   HITS   |  STALE   | EVICTED  | HIT RATE \n");
+    d.append("----------+----------+----------+----------+----------\n");
+    d.append(" %8u | %8u | %8u | %8u |   %3u%%  \n",
+             mLookups, mHits, mStaleHits, mEvictions, rate);
+}
+
+} // namespace intel
+} // namespace android
@@ -0,0 +1,127 @@
+/*
+// Copyright (c) 2014 Intel Corporation 
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+#ifndef PLANE_ASSIGNMENT_CACHE_H
+#define PLANE_ASSIGNMENT_CACHE_H
+
+#include <Dump.h>
+#include <DisplayPlane.h>
+
+namespace android {
+namespace intel {
+
+// Bounded cache of solved plane assignments. A layer list is reduced to a
+// signature made of per-layer attributes that drive plane assignment plus
+// the free plane masks; a hit returns the Z order config found by the
+// previous search so it can be applied without running the recursion again.
+class PlaneAssignmentCache {
+public:
+    enum {
+        MAX_LAYERS = 16,
+        MAX_ASSIGNMENTS = 8,
+        CACHE_SIZE = 16,
+    };
+
+    enum {
+        CANDIDATE_NONE = 0,
+        CANDIDATE_CURSOR,
+        CANDIDATE_SPRITE,
+        CANDIDATE_OVERLAY,
+    };
+
+    struct Assignment {
+        int layerIndex;
+        int planeType;
+        int zorder;
+    };
+
+    struct Solution {
+        int count;
+        Assignment assignments[MAX_ASSIGNMENTS];
+    };
+
+    struct Signature {
+        enum {
+            HEADER_WORDS = 2 + DisplayPlane::PLANE_MAX,
+            LAYER_WORDS = 3,
+            MAX_WORDS = HEADER_WORDS + LAYER_WORDS * MAX_LAYERS,
+        };
+
+        void reset(int disp, int layerCount);
+        void setFreePlanes(int type, uint32_t mask);
+        void addLayer(uint32_t format, uint32_t attributes, uint32_t overlap);
+        void seal();
+        bool operator==(const Signature& rhs) const;
+
+        uint32_t hash;
+        int size;
+        uint32_t words[MAX_WORDS];
+    };
+
+public:
+    PlaneAssignmentCache();
+    virtual ~PlaneAssignmentCache();
+
+public:
+    bool initialize();
+    void deinitialize();
+
+    bool lookup(const Signature& sig, Solution& solution);
+    void insert(const Signature& sig, const Solution& solution);
+    // drop an entry whose stored solution could not be applied
+    void invalidate(const Signature& sig);
+
+    // pack layer type, transform, blending and size classes into one word
+    static uint32_t packAttributes(int candidate,
+                                   uint32_t layerType,
+                                   uint32_t transform,
+                                   int32_t blending,
+                                   uint8_t planeAlpha,
+                                   int cropWidth,
+                                   int cropHeight,
+                                   int frameWidth,
+                                   int frameHeight);
+
+    // dump interface
+    void dump(Dump& d);
+
+private:
+    struct Entry {
+        bool valid;
+        uint32_t lastUsed;
+        Signature signature;
+        Solution solution;
+    };
+
+    static uint32_t sizeClass(int size);
+    int find(const Signature& sig);
+
+private:
+    bool mInitialized;
+    uint32_t mClock;
+    Entry mEntries[CACHE_SIZE];
+
+    // statistics
+    uint32_t mLookups;
+    uint32_t mHits;
+    uint32_t mStaleHits;
+    uint32_t mEvictions;
+};
+
+} // namespace intel
+} // namespace android
+
+
+#endif /* PLANE_ASSIGNMENT_CACHE_H */
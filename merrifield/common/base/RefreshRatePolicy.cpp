@@ -0,0 +1,169 @@
+/*
+// Copyright (c) 2014 Intel Corporation 
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+#include <HwcTrace.h>
+#include <CadenceTracker.h>
+#include <RefreshRatePolicy.h>
+
+namespace android {
+namespace intel {
+
+RefreshRatePolicy::RefreshRatePolicy()
+    : mRateCount(0),
+      mHysteresis(DEFAULT_HYSTERESIS_MS),
+      mStaticLowering(false),
+      mTarget(RATE_NONE),
+      mCandidate(RATE_NONE),
+      mCandidateTime(0),
+      mSwitches(0),
+      mRejected(0)
+{
+    memset(mRates, 0, sizeof(mRates));
+}
+
+RefreshRatePolicy::~RefreshRatePolicy()
+{
+}
+
+void RefreshRatePolicy::setRates(const uint32_t *rates, int count, uint32_t active)
+{
+    mRateCount = 0;
+    for (int i = 0; i < count && mRateCount < MAX_RATES; i++) {
+        // sorted without duplicates
+        int j = mRateCount;
+        bool exists = false;
+        for (int k = 0; k < mRateCount; k++) {
+            if (mRates[k] == rates[i]) {
+                exists = true;
+                break;
+            }
+        }
+        if (exists || rates[i] == 0) {
+            continue;
+        }
+        while (j > 0 && mRates[j - 1] > rates[i]) {
+            mRates[j] = mRates[j - 1];
+            j--;
+        }
+        mRates[j] = rates[i];
+        mRateCount++;
+    }
+
+    // the mode may have been changed by someone else
+    mTarget = active;
+}
+
+void RefreshRatePolicy::setHysteresis(uint32_t ms)
+{
+    mHysteresis = ms;
+}
+
+void RefreshRatePolicy::setStaticLowering(bool enabled)
+{
+    mStaticLowering = enabled;
+}
+
+void RefreshRatePolicy::reset()
+{
+    mRateCount = 0;
+    mTarget = RATE_NONE;
+    mCandidate = RATE_NONE;
+    mCandidateTime = 0;
+}
+
+uint32_t RefreshRatePolicy::pickRate(const uint32_t *rates, int count,
+                                     uint32_t contentRate, int cadence)
+{
+    if (count == 0) {
+        return RATE_NONE;
+    }
+
+    // static content looks the same at any rate
+    if (contentRate == 0) {
+        return rates[0];
+    }
+
+    // nominal rate of a detected cadence, otherwise the measured rate if
+    // it is close to an integer number of frames per second
+    uint32_t fps = CadenceTracker::getCadenceRate(cadence) / 100;
+    if (fps == 0) {
+        uint32_t rounded = (contentRate + 50) / 100;
+        uint32_t diff = (contentRate > rounded * 100) ?
+            contentRate - rounded * 100 : rounded * 100 - contentRate;
+        if (rounded == 0 || diff * 100 > rounded * 100 * RATE_TOLERANCE) {
+            return rates[count - 1];
+        }
+        fps = rounded;
+    }
+
+    // rates are sorted, the first multiple is the lowest one
+    for (int i = 0; i < count; i++) {
+        if (rates[i] >= fps && rates[i] % fps == 0) {
+            return rates[i];
+        }
+    }
+    return rates[count - 1];
+}
+
+bool RefreshRatePolicy::update(uint32_t contentRate, int cadence, nsecs_t now,
+                               uint32_t& hz)
+{
+    if (mRateCount == 0 || (contentRate == 0 && !mStaticLowering)) {
+        mCandidate = RATE_NONE;
+        return false;
+    }
+
+    uint32_t rate = pickRate(mRates, mRateCount, contentRate, cadence);
+    if (rate == mTarget) {
+        mCandidate = RATE_NONE;
+        return false;
+    }
+
+    if (rate != mCandidate) {
+        if (mCandidate != RATE_NONE) {
+            mRejected++;
+        }
+        mCandidate = rate;
+        mCandidateTime = now;
+    }
+
+    uint32_t hold = mHysteresis;
+    if (contentRate == 0 && hold < STATIC_HYSTERESIS_MS) {
+        hold = STATIC_HYSTERESIS_MS;
+    }
+    if (now - mCandidateTime < ms2ns(hold)) {
+        return false;
+    }
+
+    DTRACE("refresh rate %u -> %u, content rate %u", mTarget, rate, contentRate);
+    mTarget = rate;
+    mCandidate = RATE_NONE;
+    mSwitches++;
+    hz = rate;
+    return true;
+}
+
+void RefreshRatePolicy::dump(Dump& d)
+{
+    d.append("Refresh rate policy: (target %u Hz, %d rates)\n",
+             mTarget, mRateCount);
+    d.append(" SWITCHES | REJECTED | CANDIDATE \n");
+    d.append("----------+----------+-----------\n");
+    d.append(" %8u | %8u | %6u Hz \n",
+             mSwitches, mRejected, mCandidate);
+}
+
+} // namespace intel
+} // namespace android
@@ -0,0 +1,97 @@
+/*
+// Copyright (c) 2014 Intel Corporation 
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+#ifndef REFRESH_RATE_POLICY_H
+#define REFRESH_RATE_POLICY_H
+
+#include <Dump.h>
+#include <utils/Timers.h>
+
+namespace android {
+namespace intel {
+
+// Picks the display refresh rate for the measured content rate. The lowest
+// rate that is an exact multiple of the content rate is chosen so that every
+// frame stays on screen for the same number of refreshes, content that fits
+// no rate gets the highest one. Static content keeps the current rate: a
+// mode switch resyncs the TV and restarts HDCP, so it is only lowered for
+// static content when asked to. A new choice has to hold for some time
+// before it is applied. The policy has no device dependency, modes, content
+// rates and time are fed by the caller.
+class RefreshRatePolicy {
+public:
+    enum {
+        MAX_RATES = 16,
+        // time a new choice must hold
+        DEFAULT_HYSTERESIS_MS = 1000,
+        // static content only lowers the rate after a longer hold, so that
+        // short pauses of moving content do not switch modes twice
+        STATIC_HYSTERESIS_MS = 3000,
+        // no rate is known
+        RATE_NONE = 0,
+    };
+
+public:
+    RefreshRatePolicy();
+    ~RefreshRatePolicy();
+
+public:
+    // refresh rates in Hz available at the current resolution and the
+    // rate of the active mode, which is the rate applied until a change
+    void setRates(const uint32_t *rates, int count, uint32_t active);
+    bool hasRates() const { return mRateCount > 0; }
+    void setHysteresis(uint32_t ms);
+    // switch static content to the lowest rate, off by default
+    void setStaticLowering(bool enabled);
+    void reset();
+
+    // feed the content rate of a frame in 1/100 fps and its cadence, 0 if
+    // the content is static. Returns true with the new refresh rate when
+    // it needs to be changed
+    bool update(uint32_t contentRate, int cadence, nsecs_t now, uint32_t& hz);
+
+    // rate for the content rate out of sorted rates, the lowest one for
+    // static content. RATE_NONE if there is no rate
+    static uint32_t pickRate(const uint32_t *rates, int count,
+                             uint32_t contentRate, int cadence);
+
+    // dump interface
+    void dump(Dump& d);
+
+private:
+    enum {
+        // measured rates within this percentage of an integer fps count
+        RATE_TOLERANCE = 2,
+    };
+
+    uint32_t mRates[MAX_RATES];
+    int mRateCount;
+    uint32_t mHysteresis;
+    bool mStaticLowering;
+    // rate applied and rate waiting for the hysteresis since a time
+    uint32_t mTarget;
+    uint32_t mCandidate;
+    nsecs_t mCandidateTime;
+
+    // statistics
+    uint32_t mSwitches;
+    uint32_t mRejected;
+};
+
+} // namespace intel
+} // namespace android
+
+
+#endif /* REFRESH_RATE_POLICY_H */
@@ -0,0 +1,407 @@
+/*
+// Copyright (c) 2014 Intel Corporation 
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+#include <unistd.h>
+#include <HwcTrace.h>
+#include <Hwcomposer.h>
+#include <BufferManager.h>
+#include <StaticLayerCache.h>
+#include <sync/sync.h>
+
+namespace android {
+namespace intel {
+
+StaticLayerCache::StaticLayerCache()
+    : mInitialized(false),
+      mPending(false),
+      mValid(false),
+      mCount(0),
+      mHandle(0),
+      mSize(0),
+      mQueued(false),
+      mFenceFd(-1),
+      mQueueTime(0),
+      mRetiredCount(0),
+      mBuilds(0),
+      mBuildFailures(0),
+      mTimeouts(0),
+      mHits(0),
+      mInvalidations(0),
+      mSearches(0),
+      mBlendingMisses(0)
+{
+    memset(mMembers, 0, sizeof(mMembers));
+    memset(mRetired, 0, sizeof(mRetired));
+}
+
+StaticLayerCache::~StaticLayerCache()
+{
+    WARN_IF_NOT_DEINIT();
+}
+
+bool StaticLayerCache::initialize()
+{
+    mPending = false;
+    mValid = false;
+    mCount = 0;
+    mInitialized = true;
+    return true;
+}
+
+void StaticLayerCache::deinitialize()
+{
+    if (mHandle) {
+        retireBuffer();
+    }
+    // off the prepare path, give blits still running a last chance. A
+    // buffer the blitter may still write to is leaked rather than freed
+    while (mRetiredCount) {
+        int last = mRetiredCount - 1;
+        if (!isRetiredIdle(mRetired[last], BLIT_TIMEOUT_MS)) {
+            WTRACE("leaking cache buffer %p, blits not finished",
+                   mRetired[last].handle);
+            mRetired[last].handle = 0;
+        }
+        freeRetiredBuffer(last);
+    }
+    mPending = false;
+    mValid = false;
+    mCount = 0;
+    mInitialized = false;
+}
+
+bool StaticLayerCache::build(hwc_display_contents_1_t *list,
+                             const int *indexes,
+                             int count,
+                             uint32_t format,
+                             uint32_t bpp)
+{
+    RETURN_FALSE_IF_NOT_INIT();
+
+    if (!list || count < 2 || count > MAX_LAYERS) {
+        ETRACE("invalid layer group, count = %d", count);
+        return false;
+    }
+
+    // the previous buffer may still be on screen
+    if (mHandle) {
+        retireBuffer();
+    }
+    mPending = false;
+    mValid = false;
+    mCount = 0;
+
+    if (mRetiredCount >= MAX_RETIRED) {
+        VTRACE("retired cache buffers are still blitted to");
+        mBuildFailures++;
+        return false;
+    }
+
+    const hwc_rect_t& base = list->hwLayers[indexes[0]].displayFrame;
+    uint32_t width = base.right - base.left;
+    uint32_t height = base.bottom - base.top;
+
+    BufferManager *bm = Hwcomposer::getInstance().getBufferManager();
+    mHandle = bm->allocGrallocBuffer(width, height, format,
+                                     GRALLOC_USAGE_HW_COMPOSER |
+                                     GRALLOC_USAGE_HW_RENDER |
+                                     GRALLOC_USAGE_HW_TEXTURE);
+    if (!mHandle) {
+        ETRACE("failed to allocate %ux%u cache buffer", width, height);
+        mBuildFailures++;
+        return false;
+    }
+    mSize = ((uint64_t)width * height * bpp) >> 3;
+
+    for (int i = 0; i < count; i++) {
+        const hwc_layer_1_t& layer = list->hwLayers[indexes[i]];
+        mMembers[i].index = indexes[i];
+        mMembers[i].handle = layer.handle;
+        mMembers[i].frame = layer.displayFrame;
+    }
+
+    VTRACE("%d layers to flatten into %ux%u buffer", count, width, height);
+    mCount = count;
+    mPending = true;
+    mQueued = false;
+    return true;
+}
+
+void StaticLayerCache::queueBlits(hwc_display_contents_1_t *list)
+{
+    if (!mPending || mQueued || !matches(list)) {
+        return;
+    }
+
+    // each blit waits for the acquire fence of its layer and for the blit
+    // below it, the fence of the last blit tells when the cache is ready
+    BufferManager *bm = Hwcomposer::getInstance().getBufferManager();
+    const hwc_rect_t& base = mMembers[0].frame;
+    int fenceFd = -1;
+    bool ok = true;
+    for (int i = 0; i < mCount; i++) {
+        hwc_layer_1_t& layer = list->hwLayers[mMembers[i].index];
+        int mergedFd = -1;
+        int inFenceFd = fenceFd;
+        if (layer.acquireFenceFd >= 0 && fenceFd >= 0) {
+            mergedFd = sync_merge("hwc_layer_cache", layer.acquireFenceFd, fenceFd);
+            inFenceFd = mergedFd;
+        } else if (layer.acquireFenceFd >= 0) {
+            inFenceFd = layer.acquireFenceFd;
+        }
+
+        crop_t destRect;
+        destRect.x = layer.displayFrame.left - base.left;
+        destRect.y = layer.displayFrame.top - base.top;
+        destRect.w = layer.displayFrame.right - layer.displayFrame.left;
+        destRect.h = layer.displayFrame.bottom - layer.displayFrame.top;
+        int outFenceFd = -1;
+        ok = bm->blitAsync(layer.handle, mHandle, destRect, inFenceFd, &outFenceFd);
+        if (mergedFd >= 0) {
+            close(mergedFd);
+        }
+        if (!ok) {
+            ETRACE("failed to blit layer %d", mMembers[i].index);
+            break;
+        }
+        if (fenceFd >= 0) {
+            close(fenceFd);
+        }
+        fenceFd = outFenceFd;
+    }
+
+    // the buffers of the layers are read until the blits are done, layers
+    // composed by GPU are not released before
+    if (fenceFd >= 0) {
+        for (int i = 0; i < mCount; i++) {
+            hwc_layer_1_t& layer = list->hwLayers[mMembers[i].index];
+            if (layer.compositionType == HWC_FRAMEBUFFER &&
+                layer.releaseFenceFd < 0) {
+                layer.releaseFenceFd = dup(fenceFd);
+            }
+        }
+    }
+
+    mQueued = true;
+    mFenceFd = fenceFd;
+    mQueueTime = systemTime(SYSTEM_TIME_MONOTONIC);
+    if (!ok) {
+        mBuildFailures++;
+        mPending = false;
+        mCount = 0;
+        retireBuffer();
+    }
+}
+
+bool StaticLayerCache::poll()
+{
+    if (!mPending || !mQueued) {
+        return false;
+    }
+
+    if (mFenceFd >= 0 && sync_wait(mFenceFd, 0) != 0) {
+        if (systemTime(SYSTEM_TIME_MONOTONIC) - mQueueTime <
+            ms2ns(BLIT_TIMEOUT_MS)) {
+            return false;
+        }
+        WTRACE("static layer cache blits timed out");
+        mTimeouts++;
+        mPending = false;
+        mCount = 0;
+        retireBuffer();
+        return false;
+    }
+
+    if (mFenceFd >= 0) {
+        close(mFenceFd);
+        mFenceFd = -1;
+    }
+    VTRACE("%d layers flattened", mCount);
+    mPending = false;
+    mValid = true;
+    mBuilds++;
+    return true;
+}
+
+bool StaticLayerCache::matches(hwc_display_contents_1_t *list) const
+{
+    if ((!mValid && !mPending) || !list) {
+        return false;
+    }
+
+    for (int i = 0; i < mCount; i++) {
+        const Member& m = mMembers[i];
+        if (m.index >= (int)list->numHwLayers - 1) {
+            return false;
+        }
+        const hwc_layer_1_t& layer = list->hwLayers[m.index];
+        if (layer.handle != m.handle ||
+            memcmp(&layer.displayFrame, &m.frame, sizeof(hwc_rect_t)) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool StaticLayerCache::contains(int index) const
+{
+    for (int i = 0; i < mCount; i++) {
+        if (mMembers[i].index == index) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int StaticLayerCache::getBaseIndex() const
+{
+    return mCount ? mMembers[0].index : -1;
+}
+
+void StaticLayerCache::restore(hwc_display_contents_1_t *list)
+{
+    if (!list) {
+        return;
+    }
+
+    // layers keep their index until geometry changes, after that only
+    // layers with the same buffers are the ones hidden by the cache. A
+    // pending cache hides nothing yet
+    if (!mValid) {
+        if (!mPending) {
+            mCount = 0;
+        }
+        return;
+    }
+    bool geometryChanged = (list->flags & HWC_GEOMETRY_CHANGED) != 0;
+    for (int i = 0; i < mCount; i++) {
+        const Member& m = mMembers[i];
+        if (m.index >= (int)list->numHwLayers - 1) {
+            continue;
+        }
+        hwc_layer_1_t& layer = list->hwLayers[m.index];
+        if (layer.compositionType == HWC_OVERLAY &&
+            (layer.handle == m.handle || !geometryChanged)) {
+            layer.compositionType = HWC_FRAMEBUFFER;
+        }
+    }
+
+}
+
+void StaticLayerCache::invalidate()
+{
+    if (!mValid && !mPending) {
+        return;
+    }
+
+    VTRACE("static layer cache invalidated");
+    mPending = false;
+    mValid = false;
+    mInvalidations++;
+    retireBuffer();
+}
+
+void StaticLayerCache::countHit()
+{
+    mHits++;
+}
+
+void StaticLayerCache::countSearch(bool blendingMiss)
+{
+    mSearches++;
+    if (blendingMiss) {
+        mBlendingMisses++;
+    }
+}
+
+void StaticLayerCache::postFlip()
+{
+    // blits into a buffer taken off screen must have finished as well,
+    // buffers still blitted to are polled again after the next flip
+    for (int i = mRetiredCount - 1; i >= 0; i--) {
+        Retired& r = mRetired[i];
+        if (++r.flips >= RETIRE_FLIPS && isRetiredIdle(r, 0)) {
+            freeRetiredBuffer(i);
+        }
+    }
+}
+
+void StaticLayerCache::retireBuffer()
+{
+    // build() keeps a slot free for the current buffer
+    if (mHandle && mRetiredCount < MAX_RETIRED) {
+        Retired& r = mRetired[mRetiredCount++];
+        r.handle = mHandle;
+        r.size = mSize;
+        r.fenceFd = mFenceFd;
+        r.flips = 0;
+    } else if (mHandle) {
+        ETRACE("no room to retire cache buffer %p, leaking it", mHandle);
+        if (mFenceFd >= 0) {
+            close(mFenceFd);
+        }
+    } else if (mFenceFd >= 0) {
+        close(mFenceFd);
+    }
+    mHandle = 0;
+    mSize = 0;
+    mQueued = false;
+    mFenceFd = -1;
+}
+
+bool StaticLayerCache::isRetiredIdle(const Retired& r, int timeoutMs) const
+{
+    return r.fenceFd < 0 || sync_wait(r.fenceFd, timeoutMs) == 0;
+}
+
+void StaticLayerCache::freeRetiredBuffer(int index)
+{
+    Retired& r = mRetired[index];
+    if (r.fenceFd >= 0) {
+        close(r.fenceFd);
+    }
+    if (r.handle) {
+        BufferManager *bm = Hwcomposer::getInstance().getBufferManager();
+        bm->freeGrallocBuffer(r.handle);
+    }
+
+    // keep the list packed
+    mRetired[index] = mRetired[--mRetiredCount];
+    memset(&mRetired[mRetiredCount], 0, sizeof(Retired));
+}
+
+void StaticLayerCache::dump(Dump& d)
+{
+    uint32_t retiredSize = 0;
+    for (int i = 0; i < mRetiredCount; i++) {
+        retiredSize += mRetired[i].size;
+    }
+
+    const char *state = mValid ? "valid" : (mPending ? "pending" : "invalid");
+    d.append("Static layer cache: (%s, %d layers)\n",
+             state, (mValid || mPending) ? mCount : 0);
+    d.append("  BUILDS  | FAILURES | TIMEOUTS |   HITS   | INVALID  | MEMORY KB \n");
+    d.append("----------+----------+----------+----------+----------+-----------\n");
+    d.append(" %8u | %8u | %8u | %8u | %8u | %8u \n",
+             mBuilds, mBuildFailures, mTimeouts, mHits, mInvalidations,
+             (mSize + retiredSize) >> 10);
+    // groups found only if blended layers could be flattened as well
+    d.append(" SEARCHES | BLENDED \n");
+    d.append("----------+----------\n");
+    d.append(" %8u | %8u \n", mSearches, mBlendingMisses);
+}
+
+} // namespace intel
+} // namespace android
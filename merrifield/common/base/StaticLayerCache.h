@@ -0,0 +1,138 @@
+/*
+// Copyright (c) 2014 Intel Corporation 
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+#ifndef STATIC_LAYER_CACHE_H
+#define STATIC_LAYER_CACHE_H
+
+#include <Dump.h>
+#include <hardware/hwcomposer.h>
+#include <utils/Timers.h>
+
+namespace android {
+namespace intel {
+
+// Flattened copy of a group of static layers. Layers are blitted from the
+// bottom one up into a buffer owned by HWC, which is then scanned out in
+// place of the bottom layer while the other layers of the group are hidden.
+// Blit copies pixels without blending, so every layer of a group must be
+// opaque, unscaled and inside the bottom layer.
+// A cache is built in prepare, its blits are queued at set behind the
+// acquire fences of its layers and it is used once they have finished.
+class StaticLayerCache {
+public:
+    enum {
+        MAX_LAYERS = 8,
+        // flips before a buffer taken off screen can be freed
+        RETIRE_FLIPS = 2,
+        // buffers taken off screen and not freed yet, no cache is built
+        // while all of them are waiting for their blits
+        MAX_RETIRED = 4,
+        // blits not finished by then are given up
+        BLIT_TIMEOUT_MS = 50,
+    };
+
+public:
+    StaticLayerCache();
+    virtual ~StaticLayerCache();
+
+public:
+    bool initialize();
+    void deinitialize();
+
+    // allocate a cache for layers given by index from bottom to top, the
+    // first layer defines position, size and format of the cache buffer.
+    // The cache is pending until its blits are queued and have finished.
+    // Nothing is allocated while every retired buffer is still blitted to
+    bool build(hwc_display_contents_1_t *list, const int *indexes, int count,
+               uint32_t format, uint32_t bpp);
+    // queue the blits of a pending cache, called at set while the acquire
+    // fences of the list are valid
+    void queueBlits(hwc_display_contents_1_t *list);
+    // true once the blits of a pending cache have finished, a pending
+    // cache whose blits take too long is dropped
+    bool poll();
+    bool isPending() const { return mPending; }
+    bool isQueued() const { return mQueued; }
+    bool isValid() const { return mValid; }
+    // true if the layers of the cache still have the same buffers and frames
+    bool matches(hwc_display_contents_1_t *list) const;
+    bool contains(int index) const;
+    int getBaseIndex() const;
+    buffer_handle_t getHandle() const { return mHandle; }
+    // layers hidden by the cache are marked back as HWC_FRAMEBUFFER, the
+    // layers of an invalidated cache are forgotten afterwards
+    void restore(hwc_display_contents_1_t *list);
+    void invalidate();
+    void countHit();
+    // a group search, and whether it only failed on blended layers
+    void countSearch(bool blendingMiss);
+    void postFlip();
+
+    // dump interface
+    void dump(Dump& d);
+
+private:
+    struct Member {
+        int index;
+        buffer_handle_t handle;
+        hwc_rect_t frame;
+    };
+
+    struct Retired {
+        buffer_handle_t handle;
+        uint32_t size;
+        // signaled when blits into the buffer are done, -1 if none
+        int fenceFd;
+        int flips;
+    };
+
+    void retireBuffer();
+    // true if the blits into a retired buffer are done, waits at most
+    // timeoutMs for them
+    bool isRetiredIdle(const Retired& r, int timeoutMs) const;
+    void freeRetiredBuffer(int index);
+
+private:
+    bool mInitialized;
+    bool mPending;
+    bool mValid;
+    Member mMembers[MAX_LAYERS];
+    int mCount;
+    buffer_handle_t mHandle;
+    uint32_t mSize;
+    // signaled when the queued blits are done, -1 if not queued
+    bool mQueued;
+    int mFenceFd;
+    nsecs_t mQueueTime;
+    // buffers which may still be on screen or blitted to after
+    // invalidation, a buffer is never freed before its fence signals
+    Retired mRetired[MAX_RETIRED];
+    int mRetiredCount;
+
+    // statistics
+    uint32_t mBuilds;
+    uint32_t mBuildFailures;
+    uint32_t mTimeouts;
+    uint32_t mHits;
+    uint32_t mInvalidations;
+    uint32_t mSearches;
+    uint32_t mBlendingMisses;
+};
+
+} // namespace intel
+} // namespace android
+
+
+#endif /* STATIC_LAYER_CACHE_H */
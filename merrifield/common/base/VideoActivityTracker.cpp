@@ -0,0 +1,172 @@
+/*
+// Copyright (c) 2014 Intel Corporation 
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+#include <HwcTrace.h>
+#include <Hwcomposer.h>
+#include <BufferManager.h>
+#include <IVideoPayloadManager.h>
+#include <VideoActivityTracker.h>
+
+namespace android {
+namespace intel {
+
+VideoActivityTracker::VideoActivityTracker()
+    : mHandle(0),
+      mKHandle(0),
+      mTimestamp(0),
+      mValid(false),
+      mNextMapper(0)
+{
+    memset(mMappers, 0, sizeof(mMappers));
+}
+
+VideoActivityTracker::~VideoActivityTracker()
+{
+    releaseMappers();
+}
+
+bool VideoActivityTracker::isRepeated(buffer_handle_t handle)
+{
+    if (!handle) {
+        reset();
+        return false;
+    }
+
+    // a new buffer is always a new frame, its payload is recorded so that
+    // the next presentation of the buffer can be compared against it
+    bool sameBuffer = (handle == mHandle);
+    mHandle = handle;
+
+    buffer_handle_t khandle;
+    int64_t timestamp;
+    if (!readPayload(handle, khandle, timestamp)) {
+        mValid = false;
+        return false;
+    }
+
+    bool repeated = sameBuffer && mValid &&
+                    khandle == mKHandle &&
+                    timestamp == mTimestamp;
+    mKHandle = khandle;
+    mTimestamp = timestamp;
+    mValid = true;
+    return repeated;
+}
+
+bool VideoActivityTracker::getPayload(buffer_handle_t& khandle,
+                                      int64_t& timestamp) const
+{
+    if (!mValid) {
+        return false;
+    }
+
+    khandle = mKHandle;
+    timestamp = mTimestamp;
+    return true;
+}
+
+void VideoActivityTracker::reset()
+{
+    mHandle = 0;
+    mKHandle = 0;
+    mTimestamp = 0;
+    mValid = false;
+    releaseMappers();
+}
+
+bool VideoActivityTracker::readPayload(buffer_handle_t handle,
+                                       buffer_handle_t& khandle,
+                                       int64_t& timestamp)
+{
+    IVideoPayloadManager *pm = Hwcomposer::getInstance().getVideoPayloadManager();
+    if (!pm) {
+        return false;
+    }
+
+    BufferMapper *mapper = getMapper(handle);
+    if (!mapper) {
+        return false;
+    }
+
+    IVideoPayloadManager::MetaData metadata;
+    if (!pm->getMetaData(mapper, &metadata)) {
+        VTRACE("no payload for buffer %p", handle);
+        return false;
+    }
+
+    khandle = metadata.normalBuffer.khandle;
+    timestamp = metadata.timestamp;
+    return true;
+}
+
+BufferMapper* VideoActivityTracker::getMapper(buffer_handle_t handle)
+{
+    BufferManager *bm = Hwcomposer::getInstance().getBufferManager();
+    if (!bm) {
+        return NULL;
+    }
+
+    // a handle reused by a new allocation gets a new stamp
+    BufferMetadata meta;
+    if (!bm->getMetadata(handle, meta)) {
+        ETRACE("failed to get buffer");
+        return NULL;
+    }
+
+    for (int i = 0; i < MAPPER_CACHE_SIZE; i++) {
+        if (mMappers[i].mapper && mMappers[i].key == meta.key) {
+            return mMappers[i].mapper;
+        }
+    }
+
+    DataBuffer *buffer = bm->lockDataBuffer(handle);
+    if (!buffer) {
+        ETRACE("failed to get buffer");
+        return NULL;
+    }
+
+    // mapper is shared with the plane scanning out the buffer
+    BufferMapper *mapper = bm->map(*buffer);
+    bm->unlockDataBuffer(buffer);
+    if (!mapper) {
+        ETRACE("failed to map buffer %p", handle);
+        return NULL;
+    }
+
+    Mapper& slot = mMappers[mNextMapper];
+    if (slot.mapper) {
+        bm->unmap(slot.mapper);
+    }
+    slot.key = meta.key;
+    slot.mapper = mapper;
+    mNextMapper = (mNextMapper + 1) % MAPPER_CACHE_SIZE;
+    return mapper;
+}
+
+void VideoActivityTracker::releaseMappers()
+{
+    BufferManager *bm = Hwcomposer::getInstance().getBufferManager();
+    for (int i = 0; i < MAPPER_CACHE_SIZE; i++) {
+        if (mMappers[i].mapper && bm) {
+            bm->unmap(mMappers[i].mapper);
+        }
+        mMappers[i].key = 0;
+        mMappers[i].mapper = NULL;
+    }
+    mNextMapper = 0;
+}
+
+} // namespace intel
+} // namespace android
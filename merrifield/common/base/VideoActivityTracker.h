@@ -0,0 +1,76 @@
+/*
+// Copyright (c) 2014 Intel Corporation 
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+#ifndef VIDEO_ACTIVITY_TRACKER_H
+#define VIDEO_ACTIVITY_TRACKER_H
+
+#include <hardware/hwcomposer.h>
+#include <BufferMapper.h>
+
+namespace android {
+namespace intel {
+
+// Follows decoded frames of a video layer. A paused video keeps presenting
+// the same buffer, the buffer only carries a new frame if the decoder has
+// written another surface or timestamp into its payload.
+class VideoActivityTracker {
+public:
+    enum {
+        // mappers are kept for the buffers of a typical buffer queue
+        MAPPER_CACHE_SIZE = 4,
+    };
+
+public:
+    VideoActivityTracker();
+    ~VideoActivityTracker();
+
+public:
+    // true if the buffer carries the same frame as in the last call, the
+    // payload is read and recorded on every call
+    bool isRepeated(buffer_handle_t handle);
+    // payload recorded by the last call of isRepeated
+    bool getPayload(buffer_handle_t& khandle, int64_t& timestamp) const;
+    // forget the recorded frame and the mapped buffers
+    void reset();
+
+private:
+    // decoder surface and media timestamp in the payload of a video buffer
+    bool readPayload(buffer_handle_t handle,
+                     buffer_handle_t& khandle,
+                     int64_t& timestamp);
+    BufferMapper* getMapper(buffer_handle_t handle);
+    void releaseMappers();
+
+private:
+    buffer_handle_t mHandle;
+    buffer_handle_t mKHandle;
+    int64_t mTimestamp;
+    // payload of mHandle has been read
+    bool mValid;
+
+    // buffers mapped for payload reads, by allocation stamp
+    struct Mapper {
+        uint64_t key;
+        BufferMapper *mapper;
+    };
+    Mapper mMappers[MAPPER_CACHE_SIZE];
+    int mNextMapper;
+};
+
+} // namespace intel
+} // namespace android
+
+
+#endif /* VIDEO_ACTIVITY_TRACKER_H */
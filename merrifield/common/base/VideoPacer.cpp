@@ -0,0 +1,139 @@
+/*
+// Copyright (c) 2014 Intel Corporation 
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+#include <HwcTrace.h>
+#include <VideoPacer.h>
+
+namespace android {
+namespace intel {
+
+VideoPacer::VideoPacer()
+    : mFrames(0),
+      mDeferredFrames(0),
+      mLateFrames(0),
+      mUnevenFrames(0),
+      mRestarts(0),
+      mJudder(0)
+{
+    reset();
+}
+
+VideoPacer::~VideoPacer()
+{
+}
+
+void VideoPacer::reset()
+{
+    mAnchored = false;
+    mAnchorPts = 0;
+    mAnchorVsync = 0;
+    mLastPts = 0;
+    mLastShown = 0;
+}
+
+void VideoPacer::anchor(int64_t pts, nsecs_t vsync)
+{
+    mAnchored = true;
+    mAnchorPts = pts;
+    mAnchorVsync = vsync;
+}
+
+bool VideoPacer::schedule(int64_t pts,
+                          nsecs_t now,
+                          nsecs_t lastVsync,
+                          nsecs_t period,
+                          bool allowDefer)
+{
+    if (period <= 0) {
+        reset();
+        return false;
+    }
+
+    // a deferred frame presented again is on time now
+    if (mAnchored && pts == mLastPts) {
+        return false;
+    }
+
+    // first vsync a flip submitted now is shown on
+    nsecs_t next = lastVsync;
+    if (now >= lastVsync) {
+        next += period * ((now - lastVsync) / period + 1);
+    }
+
+    if (!mAnchored || pts <= mLastPts ||
+        us2ns(pts - mLastPts) > ms2ns(MAX_PTS_GAP_MS)) {
+        // first frame, seek or pause
+        if (mAnchored) {
+            mRestarts++;
+        }
+        anchor(pts, next);
+        mFrames++;
+        mLastPts = pts;
+        mLastShown = next;
+        return false;
+    }
+
+    // refreshes between the next vsync and the one the frame is due on.
+    // A quarter period bias keeps content rates that are a half multiple
+    // of the refresh period away from rounding boundaries
+    nsecs_t offset = mAnchorVsync + us2ns(pts - mAnchorPts) - next + period / 4;
+    int64_t vsyncs = (offset >= 0) ? offset / period :
+                                     -((-offset + period - 1) / period);
+
+    nsecs_t shown = next;
+    bool defer = false;
+    if (vsyncs > MAX_DRIFT_VSYNCS || vsyncs < -MAX_DRIFT_VSYNCS) {
+        // far off the timeline after a stall, start a new one
+        VTRACE("frame is %lld vsyncs off, restarting timeline", vsyncs);
+        mRestarts++;
+        anchor(pts, next);
+    } else if (vsyncs > 0 && allowDefer) {
+        // flipped again after the next vsync, shown one refresh later
+        shown = next + MAX_HOLD_VSYNCS * period;
+        defer = true;
+        mDeferredFrames++;
+    } else if (vsyncs < 0) {
+        mLateFrames++;
+    }
+
+    // on-screen duration of the previous frame against its media duration,
+    // an error over a refresh period is a doubled or a dropped frame
+    nsecs_t error = (shown - mLastShown) - us2ns(pts - mLastPts);
+    if (error < 0) {
+        error = -error;
+    }
+    mJudder = (mJudder * 15 + error) / 16;
+    if (error > period) {
+        mUnevenFrames++;
+    }
+
+    mFrames++;
+    mLastPts = pts;
+    mLastShown = shown;
+    return defer;
+}
+
+void VideoPacer::dump(Dump& d)
+{
+    d.append("Video pacing:\n");
+    d.append("  FRAMES  | DEFERRED |   LATE   |  UNEVEN  | RESTARTS | JUDDER US \n");
+    d.append("----------+----------+----------+----------+----------+-----------\n");
+    d.append(" %8u | %8u | %8u | %8u | %8u | %9u \n",
+             mFrames, mDeferredFrames, mLateFrames, mUnevenFrames, mRestarts,
+             (uint32_t)ns2us(mJudder));
+}
+
+} // namespace intel
+} // namespace android
@@ -0,0 +1,84 @@
+/*
+// Copyright (c) 2014 Intel Corporation 
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+#ifndef VIDEO_PACER_H
+#define VIDEO_PACER_H
+
+#include <Dump.h>
+#include <utils/Timers.h>
+
+namespace android {
+namespace intel {
+
+// Paces video frames on the vsync timeline. The media timestamp of the
+// first frame is anchored to a vsync, every later frame is due on the vsync
+// nearest to its timestamp on that timeline. A frame that is early is
+// deferred by one refresh, the caller skips its flip and presents it again
+// after the next vsync. A late frame is flipped right away and the timeline
+// restarts when it falls too far behind.
+// The judder metric is the mean difference between the on-screen and the
+// media duration of frames.
+class VideoPacer {
+public:
+    enum {
+        // frames are deferred by at most one refresh
+        MAX_HOLD_VSYNCS = 1,
+        // timeline restarts when a frame is off by more refreshes
+        MAX_DRIFT_VSYNCS = 3,
+        // timestamp gaps longer than this are seeks or pauses
+        MAX_PTS_GAP_MS = 500,
+    };
+
+public:
+    VideoPacer();
+    ~VideoPacer();
+
+public:
+    void reset();
+    // a frame with media timestamp in microseconds is about to be flipped.
+    // Returns true if its flip is to be deferred by one refresh, always
+    // false if deferring is not allowed or the frame was deferred already
+    bool schedule(int64_t pts, nsecs_t now, nsecs_t lastVsync,
+                  nsecs_t period, bool allowDefer);
+
+    // dump interface
+    void dump(Dump& d);
+
+private:
+    void anchor(int64_t pts, nsecs_t vsync);
+
+private:
+    bool mAnchored;
+    int64_t mAnchorPts;
+    nsecs_t mAnchorVsync;
+    int64_t mLastPts;
+    // vsync the last frame is shown on
+    nsecs_t mLastShown;
+
+    // statistics
+    uint32_t mFrames;
+    uint32_t mDeferredFrames;
+    uint32_t mLateFrames;
+    uint32_t mUnevenFrames;
+    uint32_t mRestarts;
+    // moving average of the duration error in nanoseconds
+    nsecs_t mJudder;
+};
+
+} // namespace intel
+} // namespace android
+
+
+#endif /* VIDEO_PACER_H */
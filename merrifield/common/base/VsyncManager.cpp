@@ -32,7 +32,10 @@ VsyncManager::VsyncManager(Hwcomposer &hwc)
       mEnableDynamicVsync(true),
       mEnabled(false),
       mVsyncSource(IDisplayDevice::DEVICE_COUNT),
-      mLock()
+      mLock(),
+      mTimelineDisp(IDisplayDevice::DEVICE_COUNT),
+      mLastVsync(0),
+      mVsyncPeriod(0)
 {
 }
 
@@ -143,6 +146,41 @@ IDisplayDevice* VsyncManager::getDisplayDevice(int dispType ) {
     return mHwc.getDisplayDevice(dispType);
 }
 
+void VsyncManager::onVsync(int disp, int64_t timestamp)
+{
+    Mutex::Autolock l(mTimelineLock);
+
+    if (disp != mTimelineDisp) {
+        // vsync source is switched, start a new timeline
+        mTimelineDisp = disp;
+        mVsyncPeriod = 0;
+    } else {
+        nsecs_t interval = timestamp - mLastVsync;
+        if (interval > 0 && interval <= ms2ns(MAX_PERIOD_MS)) {
+            // moving average, the first interval is taken as it is
+            if (mVsyncPeriod == 0) {
+                mVsyncPeriod = interval;
+            } else {
+                mVsyncPeriod = (mVsyncPeriod * 7 + interval) / 8;
+            }
+        }
+    }
+    mLastVsync = timestamp;
+}
+
+bool VsyncManager::getVsyncTimeline(int disp, nsecs_t& last, nsecs_t& period)
+{
+    Mutex::Autolock l(mTimelineLock);
+
+    if (disp != mTimelineDisp || mVsyncPeriod == 0 ||
+        systemTime(SYSTEM_TIME_MONOTONIC) - mLastVsync > ms2ns(TIMELINE_TIMEOUT_MS)) {
+        return false;
+    }
+    last = mLastVsync;
+    period = mVsyncPeriod;
+    return true;
+}
+
 int VsyncManager::getCandidate()
 {
     if (!mEnableDynamicVsync) {
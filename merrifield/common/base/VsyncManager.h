@@ -18,6 +18,7 @@
 
 #include <IDisplayDevice.h>
 #include <utils/threads.h>
+#include <utils/Timers.h>
 
 namespace android {
 namespace intel {
@@ -37,6 +38,10 @@ public:
     void resetVsyncSource();
     int getVsyncSource();
     void enableDynamicVsync(bool enable);
+    // vsync timeline: time of the last vsync of the display and the
+    // estimated refresh period, false if the display has no recent vsync
+    void onVsync(int disp, int64_t timestamp);
+    bool getVsyncTimeline(int disp, nsecs_t& last, nsecs_t& period);
 
 private:
     inline int getCandidate();
@@ -52,6 +57,18 @@ private:
     int  mVsyncSource;
     Mutex mLock;
 
+    // vsync timeline, updated from the vsync thread
+    enum {
+        // timeline older than this is not used
+        TIMELINE_TIMEOUT_MS = 1000,
+        // intervals longer than this are missed or disabled vsyncs
+        MAX_PERIOD_MS = 50,
+    };
+    Mutex mTimelineLock;
+    int mTimelineDisp;
+    nsecs_t mLastVsync;
+    nsecs_t mVsyncPeriod;
+
 private:
     // toggle this constant to use primary vsync only or enable dynamic vsync.
     static const bool scUsePrimaryVsyncOnly = false;
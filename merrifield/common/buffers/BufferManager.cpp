@@ -17,6 +17,8 @@
 #include <HwcTrace.h>
 #include <hardware/hwcomposer.h>
 #include <BufferManager.h>
+#include <GraphicBuffer.h>
+#include <DisplayQuery.h>
 #include <DrmConfig.h>
 
 namespace android {
@@ -73,6 +75,8 @@ bool BufferManager::initialize()
         DEINIT_AND_RETURN_FALSE("failed to create data buffer");
     }
 
+    mMetadataCache.initialize();
+
     mInitialized = true;
     return true;
 }
@@ -81,6 +85,8 @@ void BufferManager::deinitialize()
 {
     mInitialized = false;
 
+    mMetadataCache.deinitialize();
+
     if (mBufferPool) {
         // unmap & delete all cached buffer mappers
         for (size_t i = 0; i < mBufferPool->getCacheSize(); i++) {
@@ -125,6 +131,7 @@ void BufferManager::dump(Dump& d)
                  mapper->getFormat(),
                  mapper->getRef());
     }
+    mMetadataCache.dump(d);
     return;
 }
 
@@ -140,6 +147,42 @@ void BufferManager::unlockDataBuffer(DataBuffer *buffer)
     mDataBufferLock.unlock();
 }
 
+bool BufferManager::getMetadata(buffer_handle_t handle, BufferMetadata& meta)
+{
+    if (!handle) {
+        return false;
+    }
+
+    if (mMetadataCache.lookup(handle, getBufferKey(handle), meta)) {
+        return true;
+    }
+
+    // first use of this allocation
+    DataBuffer *buffer = lockDataBuffer(handle);
+    if (!buffer) {
+        ETRACE("failed to get buffer");
+        return false;
+    }
+
+    GraphicBuffer *gBuffer = (GraphicBuffer*)buffer;
+    memset(&meta, 0, sizeof(meta));
+    meta.handle = handle;
+    meta.key = buffer->getKey();
+    meta.format = buffer->getFormat();
+    meta.width = buffer->getWidth();
+    meta.height = buffer->getHeight();
+    meta.stride = buffer->getStride();
+    meta.usage = gBuffer->getUsage();
+    meta.bpp = gBuffer->getBpp();
+    meta.isTiled = DisplayQuery::isTiledFormat(meta.format);
+    meta.isProtected = GraphicBuffer::isProtectedBuffer(gBuffer);
+    meta.isCompressed = GraphicBuffer::isCompressionBuffer(gBuffer);
+    unlockDataBuffer(buffer);
+
+    mMetadataCache.insert(meta);
+    return true;
+}
+
 DataBuffer* BufferManager::get(buffer_handle_t handle)
 {
     return createDataBuffer(mGrallocModule, handle);
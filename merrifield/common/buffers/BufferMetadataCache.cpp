@@ -0,0 +1,163 @@
+/*
+// Copyright (c) 2014 Intel Corporation 
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+#include <HwcTrace.h>
+#include <cutils/atomic.h>
+#include <BufferMetadataCache.h>
+
+namespace android {
+namespace intel {
+
+BufferMetadataCache::BufferMetadataCache()
+    : mInitialized(false),
+      mEvictHand(0),
+      mEntries(0),
+      mFills(0),
+      mRefills(0),
+      mEvictions(0)
+{
+    memset(mSlots, 0, sizeof(mSlots));
+}
+
+BufferMetadataCache::~BufferMetadataCache()
+{
+    WARN_IF_NOT_DEINIT();
+}
+
+bool BufferMetadataCache::initialize()
+{
+    Mutex::Autolock _l(mLock);
+    memset(mSlots, 0, sizeof(mSlots));
+    mEntries = 0;
+    mInitialized = true;
+    return true;
+}
+
+void BufferMetadataCache::deinitialize()
+{
+    Mutex::Autolock _l(mLock);
+    mInitialized = false;
+    memset(mSlots, 0, sizeof(mSlots));
+    mEntries = 0;
+}
+
+uint32_t BufferMetadataCache::hash(buffer_handle_t handle)
+{
+    // handles are heap pointers, drop the alignment bits before mixing
+    uint32_t h = (uint32_t)((uintptr_t)handle >> 4);
+    return (h * 2654435761UL) >> 24;
+}
+
+bool BufferMetadataCache::lookup(buffer_handle_t handle,
+                                 uint64_t key,
+                                 BufferMetadata& meta) const
+{
+    if (!mInitialized || !handle) {
+        return false;
+    }
+
+    uint32_t index = hash(handle);
+    for (int i = 0; i < MAX_PROBES; i++) {
+        const Slot& slot = mSlots[(index + i) % CACHE_SIZE];
+        int32_t seq = android_atomic_acquire_load(&slot.seq);
+        if (seq & 1) {
+            // being written, let the caller take the slow path
+            return false;
+        }
+
+        BufferMetadata copy;
+        memcpy(&copy, (const void *)&slot.meta, sizeof(copy));
+        // the acquire load below does not keep the copy from being
+        // reordered past it, a torn record must not pass the check
+        android_memory_barrier();
+        if (android_atomic_acquire_load(&slot.seq) != seq) {
+            return false;
+        }
+
+        if (copy.handle == handle) {
+            if (copy.key != key) {
+                // handle is reused by a new allocation
+                return false;
+            }
+            meta = copy;
+            return true;
+        }
+        if (copy.handle == 0) {
+            // records are replaced but never removed, so probing can
+            // stop at the first empty slot
+            return false;
+        }
+    }
+    return false;
+}
+
+void BufferMetadataCache::write(Slot& slot, const BufferMetadata& meta)
+{
+    // odd sequence while the record is inconsistent
+    android_atomic_inc(&slot.seq);
+    memcpy((void *)&slot.meta, &meta, sizeof(meta));
+    android_atomic_inc(&slot.seq);
+}
+
+void BufferMetadataCache::insert(const BufferMetadata& meta)
+{
+    Mutex::Autolock _l(mLock);
+
+    if (!mInitialized || !meta.handle) {
+        return;
+    }
+
+    uint32_t index = hash(meta.handle);
+    Slot *empty = NULL;
+    for (int i = 0; i < MAX_PROBES; i++) {
+        Slot& slot = mSlots[(index + i) % CACHE_SIZE];
+        if (slot.meta.handle == meta.handle) {
+            if (slot.meta.key != meta.key) {
+                VTRACE("handle %p reallocated", meta.handle);
+                mRefills++;
+            }
+            write(slot, meta);
+            return;
+        }
+        if (slot.meta.handle == 0) {
+            empty = &slot;
+            break;
+        }
+    }
+
+    if (!empty) {
+        // every probed slot is taken, the buffers they describe may be
+        // long freed. Replace them in turn
+        empty = &mSlots[(index + (mEvictHand++ % MAX_PROBES)) % CACHE_SIZE];
+        mEvictions++;
+    } else {
+        mEntries++;
+    }
+    mFills++;
+    write(*empty, meta);
+}
+
+void BufferMetadataCache::dump(Dump& d)
+{
+    Mutex::Autolock _l(mLock);
+
+    d.append("Buffer Metadata Cache: (entries %u/%d)\n", mEntries, CACHE_SIZE);
+    d.append("  FILLS   | REFILLS  | EVICTED  \n");
+    d.append("----------+----------+----------\n");
+    d.append(" %8u | %8u | %8u \n", mFills, mRefills, mEvictions);
+}
+
+} // namespace intel
+} // namespace android
@@ -0,0 +1,98 @@
+/*
+// Copyright (c) 2014 Intel Corporation 
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+#ifndef BUFFER_METADATA_CACHE_H
+#define BUFFER_METADATA_CACHE_H
+
+#include <Dump.h>
+#include <DataBuffer.h>
+#include <utils/Mutex.h>
+
+namespace android {
+namespace intel {
+
+// attributes of a gralloc buffer that never change during its allocation
+struct BufferMetadata {
+    buffer_handle_t handle;
+    // allocation stamp, a handle reused by a new allocation gets a new key
+    uint64_t key;
+    uint32_t format;
+    uint32_t width;
+    uint32_t height;
+    stride_t stride;
+    uint32_t usage;
+    uint32_t bpp;
+    bool isTiled;
+    bool isProtected;
+    bool isCompressed;
+};
+
+// Open addressed table of buffer metadata keyed by handle. Records are
+// filled once per allocation and read without a lock: every slot is
+// guarded by a sequence counter that is odd while the slot is written,
+// readers retry through the slow path if it changes under them. Gralloc
+// does not report freed buffers, so a record is replaced when its handle
+// comes back with a new allocation stamp or when its slot is needed for
+// another handle.
+class BufferMetadataCache {
+public:
+    enum {
+        CACHE_SIZE = 256,
+        MAX_PROBES = 8,
+    };
+
+public:
+    BufferMetadataCache();
+    virtual ~BufferMetadataCache();
+
+public:
+    bool initialize();
+    void deinitialize();
+
+    // lock free, true if the allocation identified by handle and key is cached
+    bool lookup(buffer_handle_t handle, uint64_t key, BufferMetadata& meta) const;
+    void insert(const BufferMetadata& meta);
+
+    // dump interface
+    void dump(Dump& d);
+
+private:
+    struct Slot {
+        volatile int32_t seq;
+        BufferMetadata meta;
+    };
+
+    static uint32_t hash(buffer_handle_t handle);
+    void write(Slot& slot, const BufferMetadata& meta);
+
+private:
+    bool mInitialized;
+    // serializes writers, readers never take it
+    Mutex mLock;
+    Slot mSlots[CACHE_SIZE];
+    uint32_t mEvictHand;
+
+    // statistics, updated by writers only
+    uint32_t mEntries;
+    uint32_t mFills;
+    uint32_t mRefills;
+    uint32_t mEvictions;
+};
+
+} // namespace intel
+} // namespace android
+
+
+#endif /* BUFFER_METADATA_CACHE_H */
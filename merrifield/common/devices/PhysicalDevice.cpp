@@ -17,6 +17,8 @@
 #include <Hwcomposer.h>
 #include <Drm.h>
 #include <PhysicalDevice.h>
+#include <DisplayAnalyzer.h>
+#include <Fnv1a.h>
 #include <cutils/properties.h>
 
 namespace android {
@@ -30,6 +32,15 @@ PhysicalDevice::PhysicalDevice(uint32_t type, Hwcomposer& hwc, DeviceControlFact
       mVsyncObserver(NULL),
       mControlFactory(controlFactory),
       mLayerList(NULL),
+      mGeometryFilter(true),
+      mSpuriousGeometry(false),
+      mGeometryHash(0),
+      mGeometrySize(0),
+      mRealGeometryChanges(0),
+      mForcedGeometryChanges(0),
+      mSpuriousGeometryChanges(0),
+      mContentRate(0),
+      mContentCadence(-1),
       mConnected(false),
       mBlank(false),
       mDisplayState(DEVICE_DISPLAY_ON),
@@ -50,6 +61,12 @@ PhysicalDevice::PhysicalDevice(uint32_t type, Hwcomposer& hwc, DeviceControlFact
     }
 
     mDisplayConfigs.setCapacity(DEVICE_COUNT);
+
+    // geometry changes with an unchanged layer structure keep planes
+    char prop[PROPERTY_VALUE_MAX];
+    if (property_get("hwc.geometry.filter", prop, "1") > 0) {
+        mGeometryFilter = atoi(prop) ? true : false;
+    }
 }
 
 PhysicalDevice::~PhysicalDevice()
@@ -66,10 +83,12 @@ void PhysicalDevice::onGeometryChanged(hwc_display_contents_1_t *list)
 
     ATRACE("disp = %d, layer number = %d", mType, list->numHwLayers);
 
-    // NOTE: should NOT be here
+    // reuse the layer list so layers keep their history across geometry changes
     if (mLayerList) {
-        WTRACE("mLayerList exists");
-        DEINIT_AND_DELETE_OBJ(mLayerList);
+        if (!mLayerList->reset(list)) {
+            WTRACE("failed to reset layer list");
+        }
+        return;
     }
 
     // create a new layer list
@@ -89,16 +108,93 @@ bool PhysicalDevice::prePrepare(hwc_display_contents_1_t *display)
         if (mLayerList) {
             DEINIT_AND_DELETE_OBJ(mLayerList);
         }
+        mGeometrySize = 0;
+        mSpuriousGeometry = false;
+        // no cadence is negative, the next content rate is passed on
+        mContentRate = 0;
+        mContentCadence = -1;
         return true;
     }
 
-    // check if geometry is changed, if changed delete list
-    if ((display->flags & HWC_GEOMETRY_CHANGED) && mLayerList) {
-        DEINIT_AND_DELETE_OBJ(mLayerList);
+    mSpuriousGeometry = false;
+    if (!(display->flags & HWC_GEOMETRY_CHANGED)) {
+        return true;
+    }
+
+    // keep the plane assignment if SurfaceFlinger flags a geometry change
+    // without any structural change of the layers
+    mSpuriousGeometry = isGeometrySpurious(display);
+    if (mSpuriousGeometry) {
+        VTRACE("disp = %d, spurious geometry change", mType);
+        mSpuriousGeometryChanges++;
+        return true;
+    }
+
+    // geometry is changed, release planes of the list,
+    // layers are kept for matching against the new list
+    if (mLayerList) {
+        mLayerList->deinitialize();
     }
     return true;
 }
 
+bool PhysicalDevice::isGeometrySpurious(hwc_display_contents_1_t *list)
+{
+    // handles are reduced to their presence as buffer queues rotate them
+    // every frame, a new buffer of a layer is handled by the layer update
+    uint32_t signature[GEOMETRY_MAX_WORDS];
+    size_t size = 0;
+    bool same = false;
+    if (list->numHwLayers <= (size_t)GEOMETRY_MAX_LAYERS) {
+        signature[size++] = (uint32_t)mActiveDisplayConfig;
+        signature[size++] = (uint32_t)list->numHwLayers;
+        for (size_t i = 0; i < list->numHwLayers; i++) {
+            const hwc_layer_1_t& layer = list->hwLayers[i];
+            const hwc_rect_t& frame = layer.displayFrame;
+            signature[size++] = (uint32_t)layer.compositionType;
+            signature[size++] = layer.flags;
+            signature[size++] = layer.handle ? 1 : 0;
+            signature[size++] = layer.transform;
+            signature[size++] = (uint32_t)layer.blending;
+            signature[size++] = layer.planeAlpha;
+            memcpy(&signature[size], &layer.sourceCropf, 4 * sizeof(uint32_t));
+            size += 4;
+            signature[size++] = (uint32_t)frame.left;
+            signature[size++] = (uint32_t)frame.top;
+            signature[size++] = (uint32_t)frame.right;
+            signature[size++] = (uint32_t)frame.bottom;
+        }
+
+        Fnv1a hash;
+        hash.add(signature, size);
+        same = hash.get() == mGeometryHash &&
+            size == mGeometrySize &&
+            memcmp(signature, mGeometrySignature, size * sizeof(uint32_t)) == 0;
+        mGeometryHash = hash.get();
+    } else {
+        // too many layers to remember, every change is taken as real
+        mGeometryHash = 0;
+    }
+
+    // geometry changes forced by the analyzer always re-assign planes, as
+    // do changes of a list with layers waiting at frame buffer for a retry
+    DisplayAnalyzer *analyzer = mHwc.getDisplayAnalyzer();
+    bool forced = analyzer && analyzer->isGeometryForced(mType);
+    if (same && mGeometryFilter && !forced &&
+        mLayerList && mLayerList->isAssignmentReusable()) {
+        return true;
+    }
+
+    if (forced) {
+        mForcedGeometryChanges++;
+    } else {
+        mRealGeometryChanges++;
+    }
+    memcpy(mGeometrySignature, signature, size * sizeof(uint32_t));
+    mGeometrySize = size;
+    return false;
+}
+
 bool PhysicalDevice::prepare(hwc_display_contents_1_t *display)
 {
     RETURN_FALSE_IF_NOT_INIT();
@@ -108,7 +204,7 @@ bool PhysicalDevice::prepare(hwc_display_contents_1_t *display)
         return true;
 
     // check if geometry is changed
-    if (display->flags & HWC_GEOMETRY_CHANGED) {
+    if ((display->flags & HWC_GEOMETRY_CHANGED) && !mSpuriousGeometry) {
         onGeometryChanged(display);
     }
     if (!mLayerList) {
@@ -117,7 +213,20 @@ bool PhysicalDevice::prepare(hwc_display_contents_1_t *display)
     }
 
     // update list with new list
-    return mLayerList->update(display);
+    bool ret = mLayerList->update(display);
+
+    // content rate drives the refresh rate of the external display, it is
+    // only passed on when it changes
+    if (mType == IDisplayDevice::DEVICE_EXTERNAL) {
+        int cadence;
+        uint32_t rate = mLayerList->getContentFrameRate(&cadence);
+        if (rate != mContentRate || cadence != mContentCadence) {
+            mContentRate = rate;
+            mContentCadence = cadence;
+            mHwc.getDisplayAnalyzer()->setContentRate(mType, rate, cadence);
+        }
+    }
+    return ret;
 }
 
 
@@ -125,7 +234,22 @@ bool PhysicalDevice::commit(hwc_display_contents_1_t *display, IDisplayContext *
 {
     RETURN_FALSE_IF_NOT_INIT();
 
-    if (!display || !context || !mLayerList || mBlank) {
+    if (!display || !context || !mLayerList) {
+        return true;
+    }
+    if (mBlank) {
+        mLayerList->cancelLayerCache();
+        return true;
+    }
+    mLayerList->commitLayerCache(display);
+
+    // planes keep the early video frame, SurfaceFlinger composes again on
+    // the next vsync and the frame is flipped then. Nothing waits in set
+    if (mLayerList->paceVideo()) {
+        mLayerList->skipFlip();
+        // nothing is posted on this pipe, see TngDisplayContext::commitEnd
+        display->retireFenceFd = -1;
+        mHwc.invalidate();
         return true;
     }
     return context->commitContents(display, mLayerList);
@@ -517,6 +641,15 @@ void PhysicalDevice::dump(Dump& d)
                      config->getDpiY());
         }
     }
+    uint32_t total = mRealGeometryChanges + mForcedGeometryChanges +
+                     mSpuriousGeometryChanges;
+    d.append("Geometry changes (filter %s):\n", mGeometryFilter ? "on" : "off");
+    d.append("   REAL   |  FORCED  | SPURIOUS | FILTERED \n");
+    d.append("----------+----------+----------+----------\n");
+    d.append(" %8u | %8u | %8u |   %3u%%  \n",
+             mRealGeometryChanges, mForcedGeometryChanges,
+             mSpuriousGeometryChanges,
+             total ? (mSpuriousGeometryChanges * 100 / total) : 0);
     // dump layer list
     if (mLayerList)
         mLayerList->dump(d);
@@ -2246,10 +2246,11 @@ bool VirtualDevice::initialize()
     memset(&mLastInputFrameInfo, 0, sizeof(mLastInputFrameInfo));
     memset(&mLastOutputFrameInfo, 0, sizeof(mLastOutputFrameInfo));
 #endif
-    mPayloadManager = mHwc.getPlatFactory()->createVideoPayloadManager();
+    // owned by Hwcomposer, which creates it before the display devices
+    mPayloadManager = mHwc.getVideoPayloadManager();
 
     if (!mPayloadManager) {
-        DEINIT_AND_RETURN_FALSE("Failed to create payload manager");
+        DEINIT_AND_RETURN_FALSE("Failed to get payload manager");
     }
 
     mVsyncObserver = new SoftVsyncObserver(*this);
@@ -2329,10 +2330,7 @@ void VirtualDevice::deinitialize()
 {
     VAStatus va_status;
 
-    if (mPayloadManager) {
-        delete mPayloadManager;
-        mPayloadManager = NULL;
-    }
+    mPayloadManager = NULL;
     DEINIT_AND_DELETE_OBJ(mVsyncObserver);
     mInitialized = false;
 }
@@ -16,7 +16,6 @@
 #include <HwcTrace.h>
 #include <Hwcomposer.h>
 #include <DisplayPlane.h>
-#include <GraphicBuffer.h>
 
 namespace android {
 namespace intel {
@@ -165,10 +164,10 @@ void DisplayPlane::setPlaneAlpha(uint8_t alpha, uint32_t blending)
 bool DisplayPlane::setDataBuffer(buffer_handle_t handle)
 {
     DataBuffer *buffer;
+    BufferMetadata meta;
     BufferMapper *mapper;
     ssize_t index;
     bool ret;
-    bool isCompression;
     BufferManager *bm = Hwcomposer::getInstance().getBufferManager();
 
     RETURN_FALSE_IF_NOT_INIT();
@@ -187,23 +186,27 @@ bool DisplayPlane::setDataBuffer(buffer_handle_t handle)
     if (!mUpdateMasks)
         return true;
 
-    buffer = bm->lockDataBuffer(handle);
-    if (!buffer) {
+    if (!bm->getMetadata(handle, meta)) {
         ETRACE("failed to get buffer");
         return false;
     }
 
-    mIsProtectedBuffer = GraphicBuffer::isProtectedBuffer((GraphicBuffer*)buffer);
-    isCompression = GraphicBuffer::isCompressionBuffer((GraphicBuffer*)buffer);
+    mIsProtectedBuffer = meta.isProtected;
 
     // map buffer if it's not in cache
-    index = mDataBuffers.indexOfKey(buffer->getKey());
+    index = mDataBuffers.indexOfKey(meta.key);
     if (index < 0) {
         VTRACE("unmapped buffer, mapping...");
+        buffer = bm->lockDataBuffer(handle);
+        if (!buffer) {
+            ETRACE("failed to get buffer");
+            return false;
+        }
         mapper = mapBuffer(buffer);
+        // unlock buffer after getting mapper
+        bm->unlockDataBuffer(buffer);
         if (!mapper) {
             ETRACE("failed to map buffer %p", handle);
-            bm->unlockDataBuffer(buffer);
             return false;
         }
     } else {
@@ -214,11 +217,7 @@ bool DisplayPlane::setDataBuffer(buffer_handle_t handle)
     // always update source crop to mapper
     mapper->setCrop(mSrcCrop.x, mSrcCrop.y, mSrcCrop.w, mSrcCrop.h);
 
-    mapper->setIsCompression(isCompression);
-
-    // unlock buffer after getting mapper
-    bm->unlockDataBuffer(buffer);
-    buffer = NULL;
+    mapper->setIsCompression(meta.isCompressed);
 
     ret = setDataBuffer(*mapper);
     if (ret) {
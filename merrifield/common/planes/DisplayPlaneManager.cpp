@@ -14,6 +14,7 @@
 // limitations under the License.
 */
 #include <HwcTrace.h>
+#include <cutils/properties.h>
 #include <IDisplayDevice.h>
 #include <DisplayPlaneManager.h>
 
@@ -25,6 +26,11 @@ DisplayPlaneManager::DisplayPlaneManager()
       mPrimaryPlaneCount(DEFAULT_PRIMARY_PLANE_COUNT),
       mSpritePlaneCount(0),
       mOverlayPlaneCount(0),
+      mJointAllocation(false),
+      mRebalanceCount(0),
+      mAffinityKept(0),
+      mAffinityMigrated(0),
+      mAffinityAvoided(0),
       mInitialized(false)
 {
     int i;
@@ -34,6 +40,10 @@ DisplayPlaneManager::DisplayPlaneManager()
         mFreePlanes[i] = 0;
         mReclaimedPlanes[i] = 0;
     }
+
+    memset(mReservedPlanes, 0, sizeof(mReservedPlanes));
+    memset(mDemand, 0, sizeof(mDemand));
+    memset(mDemandCount, 0, sizeof(mDemandCount));
 }
 
 DisplayPlaneManager::~DisplayPlaneManager()
@@ -86,6 +96,12 @@ bool DisplayPlaneManager::initialize()
         mFreePlanes[i] = ((1 << mPlaneCount[i]) - 1);
     }
 
+    char prop[PROPERTY_VALUE_MAX];
+    if (property_get("hwc.plane.joint_alloc", prop, "0") > 0) {
+        mJointAllocation = atoi(prop) ? true : false;
+    }
+    ITRACE("joint plane allocation is %s", mJointAllocation ? "enabled" : "disabled");
+
     // allocate plane pools
     for (i = 0; i < DisplayPlane::PLANE_MAX; i++) {
         if (mPlaneCount[i]) {
@@ -223,6 +239,42 @@ bool DisplayPlaneManager::isFreePlane(int type, int index)
     return true;
 }
 
+void DisplayPlaneManager::countAffinity(HwcLayer *hwcLayer, DisplayPlane *plane)
+{
+    if (!hwcLayer || !plane ||
+        hwcLayer->getType() == HwcLayer::LAYER_FRAMEBUFFER_TARGET) {
+        return;
+    }
+
+    DisplayPlane *last = hwcLayer->getLastPlane();
+    if (last == NULL) {
+        return;
+    }
+
+    if (last == plane) {
+        mAffinityKept++;
+    } else {
+        mAffinityMigrated++;
+    }
+}
+
+void DisplayPlaneManager::countAvoidedMigrations(int count)
+{
+    if (count > 0) {
+        mAffinityAvoided += count;
+    }
+}
+
+bool DisplayPlaneManager::isFreePlane(int dsp, int type, int index)
+{
+    if (type < 0 || type >= DisplayPlane::PLANE_MAX) {
+        ETRACE("Invalid plane type %d", type);
+        return false;
+    }
+
+    return (getPlaneMask(dsp, type) & (1 << index)) != 0;
+}
+
 int DisplayPlaneManager::getFreePlanes(int dsp, int type)
 {
     RETURN_NULL_IF_NOT_INIT();
@@ -238,7 +290,7 @@ int DisplayPlaneManager::getFreePlanes(int dsp, int type)
     }
 
 
-    uint32_t freePlanes = mFreePlanes[type] | mReclaimedPlanes[type];
+    uint32_t freePlanes = getPlaneMask(dsp, type);
     if (type == DisplayPlane::PLANE_PRIMARY ||
         type == DisplayPlane::PLANE_CURSOR) {
         return ((freePlanes & (1 << dsp)) == 0) ? 0 : 1;
@@ -254,6 +306,159 @@ int DisplayPlaneManager::getFreePlanes(int dsp, int type)
     return 0;
 }
 
+bool DisplayPlaneManager::testPlanes(int dsp, ZOrderConfig& config)
+{
+    int required[DisplayPlane::PLANE_MAX];
+    memset(required, 0, sizeof(required));
+
+    for (size_t i = 0; i < config.size(); i++) {
+        int type = config[i]->planeType;
+        if (type < 0 || type >= DisplayPlane::PLANE_MAX) {
+            ETRACE("Invalid plane type %d", type);
+            return false;
+        }
+        required[type]++;
+    }
+
+    for (int i = 0; i < DisplayPlane::PLANE_MAX; i++) {
+        if (required[i] > getFreePlanes(dsp, i)) {
+            VTRACE("not enough planes for dsp %d, type %d", dsp, i);
+            return false;
+        }
+    }
+    return true;
+}
+
+uint32_t DisplayPlaneManager::getFreePlaneMask(int type) const
+{
+    if (type < 0 || type >= DisplayPlane::PLANE_MAX) {
+        ETRACE("Invalid plane type %d", type);
+        return 0;
+    }
+
+    return mFreePlanes[type] | mReclaimedPlanes[type];
+}
+
+uint32_t DisplayPlaneManager::getPlaneMask(int dsp, int type) const
+{
+    uint32_t mask = getFreePlaneMask(type);
+    if (dsp < 0 || dsp >= JOINT_DISPLAY_COUNT) {
+        return mask;
+    }
+
+    // drop planes reserved for the other displays
+    for (int i = 0; i < JOINT_DISPLAY_COUNT; i++) {
+        if (i != dsp) {
+            mask &= ~mReservedPlanes[i][type];
+        }
+    }
+    return mask;
+}
+
+uint32_t DisplayPlaneManager::getUsablePlanes(int dsp, int type) const
+{
+    if (type < 0 || type >= DisplayPlane::PLANE_MAX) {
+        ETRACE("Invalid plane type %d", type);
+        return 0;
+    }
+
+    if (type == DisplayPlane::PLANE_PRIMARY ||
+        type == DisplayPlane::PLANE_CURSOR) {
+        return 1 << dsp;
+    }
+    return (1 << mPlaneCount[type]) - 1;
+}
+
+void DisplayPlaneManager::setPlaneDemand(int dsp, int type, const uint32_t *areas, int count)
+{
+    if (dsp < 0 || dsp >= JOINT_DISPLAY_COUNT ||
+        type < 0 || type >= DisplayPlane::PLANE_MAX) {
+        return;
+    }
+
+    if (count > MAX_PLANE_DEMAND) {
+        count = MAX_PLANE_DEMAND;
+    }
+    for (int i = 0; i < count; i++) {
+        mDemand[dsp][type][i] = areas[i];
+    }
+    mDemandCount[dsp][type] = count;
+}
+
+bool DisplayPlaneManager::balancePlanes()
+{
+    if (!mJointAllocation) {
+        return false;
+    }
+
+    bool changed = false;
+    const int types[] = {DisplayPlane::PLANE_SPRITE, DisplayPlane::PLANE_OVERLAY};
+
+    for (size_t t = 0; t < sizeof(types)/sizeof(types[0]); t++) {
+        int type = types[t];
+        uint32_t shared = getUsablePlanes(IDisplayDevice::DEVICE_PRIMARY, type) &
+                          getUsablePlanes(IDisplayDevice::DEVICE_EXTERNAL, type);
+
+        // candidates are sorted by area, the largest ones go to the planes
+        // only the display itself can use
+        int next[JOINT_DISPLAY_COUNT];
+        uint32_t reserved[JOINT_DISPLAY_COUNT];
+        for (int dsp = 0; dsp < JOINT_DISPLAY_COUNT; dsp++) {
+            next[dsp] = __builtin_popcount(getUsablePlanes(dsp, type) & ~shared);
+            reserved[dsp] = 0;
+        }
+
+        // hand out shared planes one by one by marginal gain
+        while (shared) {
+            int index = __builtin_ctz(shared);
+            shared &= ~(1 << index);
+
+            int best = -1;
+            uint32_t bestArea = 0;
+            for (int dsp = 0; dsp < JOINT_DISPLAY_COUNT; dsp++) {
+                if (next[dsp] >= mDemandCount[dsp][type]) {
+                    continue;
+                }
+                uint32_t area = mDemand[dsp][type][next[dsp]];
+                if (area > bestArea) {
+                    best = dsp;
+                    bestArea = area;
+                }
+            }
+            if (best < 0) {
+                // no one needs it, leave it to first come first served
+                continue;
+            }
+            reserved[best] |= (1 << index);
+            next[best]++;
+        }
+
+        // reservation only matters when both displays compete for planes
+        if (!reserved[IDisplayDevice::DEVICE_PRIMARY] ||
+            !reserved[IDisplayDevice::DEVICE_EXTERNAL]) {
+            reserved[IDisplayDevice::DEVICE_PRIMARY] = 0;
+            reserved[IDisplayDevice::DEVICE_EXTERNAL] = 0;
+        }
+
+        for (int dsp = 0; dsp < JOINT_DISPLAY_COUNT; dsp++) {
+            if (mReservedPlanes[dsp][type] != reserved[dsp]) {
+                mReservedPlanes[dsp][type] = reserved[dsp];
+                changed = true;
+            }
+        }
+    }
+
+    if (changed) {
+        mRebalanceCount++;
+        DTRACE("shared planes re-balanced, sprite %#x/%#x, overlay %#x/%#x",
+            mReservedPlanes[0][DisplayPlane::PLANE_SPRITE],
+            mReservedPlanes[1][DisplayPlane::PLANE_SPRITE],
+            mReservedPlanes[0][DisplayPlane::PLANE_OVERLAY],
+            mReservedPlanes[1][DisplayPlane::PLANE_OVERLAY]);
+    }
+    return changed;
+}
+
 void DisplayPlaneManager::reclaimPlane(int dsp, DisplayPlane& plane)
 {
     RETURN_VOID_IF_NOT_INIT();
@@ -342,6 +547,21 @@ void DisplayPlaneManager::dump(Dump& d)
              mPlaneCount[DisplayPlane::PLANE_CURSOR],
              mFreePlanes[DisplayPlane::PLANE_CURSOR],
              mReclaimedPlanes[DisplayPlane::PLANE_CURSOR]);
+
+    d.append("Plane affinity: kept %u, migrated %u, migrations avoided %u\n",
+             mAffinityKept, mAffinityMigrated, mAffinityAvoided);
+
+    if (mJointAllocation) {
+        d.append("Joint plane allocation: (re-balanced %u times)\n", mRebalanceCount);
+        d.append(" PLANE TYPE | RESERVED PRIMARY | RESERVED EXTERNAL \n");
+        d.append("------------+------------------+-------------------\n");
+        d.append("    SPRITE  |     %08x     |     %08x\n",
+                 mReservedPlanes[0][DisplayPlane::PLANE_SPRITE],
+                 mReservedPlanes[1][DisplayPlane::PLANE_SPRITE]);
+        d.append("   OVERLAY  |     %08x     |     %08x\n",
+                 mReservedPlanes[0][DisplayPlane::PLANE_OVERLAY],
+                 mReservedPlanes[1][DisplayPlane::PLANE_OVERLAY]);
+    }
 }
 
 } // namespace intel
@@ -0,0 +1,56 @@
+/*
+// Copyright (c) 2014 Intel Corporation 
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+#ifndef FNV1A_H
+#define FNV1A_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace android {
+namespace intel {
+
+// 32-bit FNV-1a hash fed with words, each word is hashed one byte at a
+// time from the least significant byte up.
+class Fnv1a {
+public:
+    Fnv1a() : mHash(OFFSET_BASIS) {}
+
+    void add(uint32_t word) {
+        for (int i = 0; i < 4; i++) {
+            mHash ^= (word & 0xff);
+            mHash *= PRIME;
+            word >>= 8;
+        }
+    }
+    void add(const uint32_t *words, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            add(words[i]);
+        }
+    }
+    uint32_t get() const { return mHash; }
+
+private:
+    enum {
+        OFFSET_BASIS = 2166136261UL,
+        PRIME = 16777619UL,
+    };
+    uint32_t mHash;
+};
+
+} // namespace intel
+} // namespace android
+
+#endif /* FNV1A_H */
@@ -0,0 +1,128 @@
+/*
+// Copyright (c) 2014 Intel Corporation 
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+#include <math.h>
+#include <RectClip.h>
+
+namespace android {
+namespace intel {
+
+bool RectClip::isClipped(const hwc_rect_t& frame, const hwc_rect_t& bounds)
+{
+    return frame.left < bounds.left || frame.top < bounds.top ||
+           frame.right > bounds.right || frame.bottom > bounds.bottom;
+}
+
+bool RectClip::clip(const hwc_rect_t& frame,
+                    const hwc_frect_t& crop,
+                    uint32_t transform,
+                    const hwc_rect_t& bounds,
+                    int alignment,
+                    hwc_rect_t& clippedFrame,
+                    hwc_frect_t& clippedCrop)
+{
+    clippedFrame = frame;
+    clippedCrop = crop;
+
+    int frameW = frame.right - frame.left;
+    int frameH = frame.bottom - frame.top;
+    if (frameW <= 0 || frameH <= 0) {
+        return false;
+    }
+
+    // pixels cut off each edge of the display frame
+    int cut[EDGE_MAX];
+    cut[EDGE_LEFT] = (bounds.left > frame.left) ? bounds.left - frame.left : 0;
+    cut[EDGE_TOP] = (bounds.top > frame.top) ? bounds.top - frame.top : 0;
+    cut[EDGE_RIGHT] = (frame.right > bounds.right) ? frame.right - bounds.right : 0;
+    cut[EDGE_BOTTOM] = (frame.bottom > bounds.bottom) ? frame.bottom - bounds.bottom : 0;
+
+    if (cut[EDGE_LEFT] + cut[EDGE_RIGHT] >= frameW ||
+        cut[EDGE_TOP] + cut[EDGE_BOTTOM] >= frameH) {
+        // fully off screen
+        return false;
+    }
+
+    if (!cut[EDGE_LEFT] && !cut[EDGE_TOP] && !cut[EDGE_RIGHT] && !cut[EDGE_BOTTOM]) {
+        return true;
+    }
+
+    clippedFrame.left += cut[EDGE_LEFT];
+    clippedFrame.top += cut[EDGE_TOP];
+    clippedFrame.right -= cut[EDGE_RIGHT];
+    clippedFrame.bottom -= cut[EDGE_BOTTOM];
+
+    // map display edges to buffer edges. The transform flips the buffer
+    // first and then rotates it, so undo the rotation before the flips.
+    float cropW = crop.right - crop.left;
+    float cropH = crop.bottom - crop.top;
+    float scaleX, scaleY;
+    int src[EDGE_MAX];
+    if (transform & HAL_TRANSFORM_ROT_90) {
+        // buffer left edge ends up at the display top edge
+        src[EDGE_LEFT] = cut[EDGE_TOP];
+        src[EDGE_TOP] = cut[EDGE_RIGHT];
+        src[EDGE_RIGHT] = cut[EDGE_BOTTOM];
+        src[EDGE_BOTTOM] = cut[EDGE_LEFT];
+        scaleX = cropW / frameH;
+        scaleY = cropH / frameW;
+    } else {
+        src[EDGE_LEFT] = cut[EDGE_LEFT];
+        src[EDGE_TOP] = cut[EDGE_TOP];
+        src[EDGE_RIGHT] = cut[EDGE_RIGHT];
+        src[EDGE_BOTTOM] = cut[EDGE_BOTTOM];
+        scaleX = cropW / frameW;
+        scaleY = cropH / frameH;
+    }
+
+    if (transform & HAL_TRANSFORM_FLIP_H) {
+        int tmp = src[EDGE_LEFT];
+        src[EDGE_LEFT] = src[EDGE_RIGHT];
+        src[EDGE_RIGHT] = tmp;
+    }
+
+    if (transform & HAL_TRANSFORM_FLIP_V) {
+        int tmp = src[EDGE_TOP];
+        src[EDGE_TOP] = src[EDGE_BOTTOM];
+        src[EDGE_BOTTOM] = tmp;
+    }
+
+    clippedCrop.left = crop.left + src[EDGE_LEFT] * scaleX;
+    clippedCrop.top = crop.top + src[EDGE_TOP] * scaleY;
+    clippedCrop.right = crop.right - src[EDGE_RIGHT] * scaleX;
+    clippedCrop.bottom = crop.bottom - src[EDGE_BOTTOM] * scaleY;
+
+    if (alignment > 1) {
+        // grow the crop to the alignment, never beyond the original crop
+        float a = (float)alignment;
+        clippedCrop.left = floorf(clippedCrop.left / a) * a;
+        clippedCrop.top = floorf(clippedCrop.top / a) * a;
+        clippedCrop.right = ceilf(clippedCrop.right / a) * a;
+        clippedCrop.bottom = ceilf(clippedCrop.bottom / a) * a;
+        if (clippedCrop.left < crop.left)
+            clippedCrop.left = crop.left;
+        if (clippedCrop.top < crop.top)
+            clippedCrop.top = crop.top;
+        if (clippedCrop.right > crop.right)
+            clippedCrop.right = crop.right;
+        if (clippedCrop.bottom > crop.bottom)
+            clippedCrop.bottom = crop.bottom;
+    }
+
+    return true;
+}
+
+} // namespace intel
+} // namespace android
@@ -0,0 +1,56 @@
+/*
+// Copyright (c) 2014 Intel Corporation 
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+#ifndef RECT_CLIP_H
+#define RECT_CLIP_H
+
+#include <hardware/hwcomposer.h>
+
+namespace android {
+namespace intel {
+
+// Clips a layer's display frame to the display bounds and trims its source
+// crop by the same amount in buffer space, so a partially visible layer can
+// still be scanned out by a plane that cannot position outside the screen.
+class RectClip {
+public:
+    // returns false if nothing of the frame is inside the bounds. Edges of
+    // the clipped crop are snapped outwards to the given alignment (1 for
+    // RGB buffers, 2 for subsampled YUV) without leaving the original crop.
+    static bool clip(const hwc_rect_t& frame,
+                     const hwc_frect_t& crop,
+                     uint32_t transform,
+                     const hwc_rect_t& bounds,
+                     int alignment,
+                     hwc_rect_t& clippedFrame,
+                     hwc_frect_t& clippedCrop);
+
+    // true if the frame is not fully inside the bounds
+    static bool isClipped(const hwc_rect_t& frame, const hwc_rect_t& bounds);
+
+private:
+    enum {
+        EDGE_LEFT = 0,
+        EDGE_TOP,
+        EDGE_RIGHT,
+        EDGE_BOTTOM,
+        EDGE_MAX,
+    };
+};
+
+} // namespace intel
+} // namespace android
+
+#endif /* RECT_CLIP_H */
@@ -0,0 +1,127 @@
+/*
+// Copyright (c) 2014 Intel Corporation 
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+#include <VisibleRegion.h>
+
+namespace android {
+namespace intel {
+
+VisibleRegion::VisibleRegion()
+    : mCount(0),
+      mInexact(false)
+{
+}
+
+void VisibleRegion::set(const hwc_rect_t& rect)
+{
+    mCount = 0;
+    mInexact = false;
+    if (rect.right > rect.left && rect.bottom > rect.top) {
+        mRects[mCount++] = rect;
+    }
+}
+
+void VisibleRegion::subtract(const hwc_rect_t& o)
+{
+    if (o.right <= o.left || o.bottom <= o.top) {
+        return;
+    }
+
+    // rectangles are visited once, the bands split off a rectangle are
+    // appended after the ones still to be visited
+    int count = mCount;
+    int i = 0;
+    while (i < count) {
+        hwc_rect_t r = mRects[i];
+        if (o.left >= r.right || o.right <= r.left ||
+            o.top >= r.bottom || o.bottom <= r.top) {
+            i++;
+            continue;
+        }
+
+        // full width bands above and below the occluder, then the parts
+        // left and right of it between those bands
+        hwc_rect_t bands[4];
+        int n = 0;
+        int top = r.top;
+        int bottom = r.bottom;
+        if (o.top > r.top) {
+            hwc_rect_t band = { r.left, r.top, r.right, o.top };
+            bands[n++] = band;
+            top = o.top;
+        }
+        if (o.bottom < r.bottom) {
+            hwc_rect_t band = { r.left, o.bottom, r.right, r.bottom };
+            bands[n++] = band;
+            bottom = o.bottom;
+        }
+        if (o.left > r.left) {
+            hwc_rect_t band = { r.left, top, o.left, bottom };
+            bands[n++] = band;
+        }
+        if (o.right < r.right) {
+            hwc_rect_t band = { o.right, top, r.right, bottom };
+            bands[n++] = band;
+        }
+
+        // the rectangle is replaced by its bands
+        if (mCount - 1 + n > MAX_RECTS) {
+            mInexact = true;
+            i++;
+            continue;
+        }
+        mRects[i] = mRects[count - 1];
+        mRects[count - 1] = mRects[mCount - 1];
+        mCount--;
+        count--;
+        for (int j = 0; j < n; j++) {
+            mRects[mCount++] = bands[j];
+        }
+    }
+}
+
+uint32_t VisibleRegion::getArea() const
+{
+    uint32_t area = 0;
+    for (int i = 0; i < mCount; i++) {
+        area += (uint32_t)(mRects[i].right - mRects[i].left) *
+                (uint32_t)(mRects[i].bottom - mRects[i].top);
+    }
+    return area;
+}
+
+hwc_rect_t VisibleRegion::getBounds() const
+{
+    hwc_rect_t bounds = { 0, 0, 0, 0 };
+    for (int i = 0; i < mCount; i++) {
+        const hwc_rect_t& r = mRects[i];
+        if (i == 0) {
+            bounds = r;
+            continue;
+        }
+        if (r.left < bounds.left)
+            bounds.left = r.left;
+        if (r.top < bounds.top)
+            bounds.top = r.top;
+        if (r.right > bounds.right)
+            bounds.right = r.right;
+        if (r.bottom > bounds.bottom)
+            bounds.bottom = r.bottom;
+    }
+    return bounds;
+}
+
+} // namespace intel
+} // namespace android
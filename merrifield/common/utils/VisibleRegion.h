@@ -0,0 +1,61 @@
+/*
+// Copyright (c) 2014 Intel Corporation 
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+#ifndef VISIBLE_REGION_H
+#define VISIBLE_REGION_H
+
+#include <hardware/hwcomposer.h>
+
+namespace android {
+namespace intel {
+
+// Part of a layer left visible by the opaque layers above it, kept as a
+// fixed set of disjoint rectangles. Subtracting an occluder splits every
+// rectangle it hits into at most four bands. When a split does not fit, the
+// rectangle is kept whole, so the region can only over-estimate what is
+// visible.
+class VisibleRegion {
+public:
+    enum {
+        MAX_RECTS = 16,
+    };
+
+public:
+    VisibleRegion();
+
+public:
+    void set(const hwc_rect_t& rect);
+    void subtract(const hwc_rect_t& occluder);
+    void clear() { mCount = 0; }
+
+    bool isEmpty() const { return mCount == 0; }
+    int size() const { return mCount; }
+    const hwc_rect_t& itemAt(int index) const { return mRects[index]; }
+    uint32_t getArea() const;
+    // bounding box of the region, empty if the region is empty
+    hwc_rect_t getBounds() const;
+    // true if a subtraction did not fit and was dropped in part
+    bool isInexact() const { return mInexact; }
+
+private:
+    hwc_rect_t mRects[MAX_RECTS];
+    int mCount;
+    bool mInexact;
+};
+
+} // namespace intel
+} // namespace android
+
+#endif /* VISIBLE_REGION_H */
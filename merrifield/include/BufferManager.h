@@ -20,6 +20,7 @@
 #include <DataBuffer.h>
 #include <BufferMapper.h>
 #include <BufferCache.h>
+#include <BufferMetadataCache.h>
 #include <utils/Mutex.h>
 
 namespace android {
@@ -43,6 +44,11 @@ public:
     DataBuffer* lockDataBuffer(buffer_handle_t handle);
     void unlockDataBuffer(DataBuffer *buffer);
 
+    // metadata of a gralloc buffer, the handle is parsed on its first use
+    // only and later lookups do not take any lock. Must not be called
+    // between lockDataBuffer and unlockDataBuffer
+    bool getMetadata(buffer_handle_t handle, BufferMetadata& meta);
+
     // get and put interfaces are deprecated
     // use lockDataBuffer and unlockDataBuffer instead
     DataBuffer* get(buffer_handle_t handle);
@@ -61,11 +67,18 @@ public:
     void freeGrallocBuffer(buffer_handle_t handle);
     virtual bool blit(buffer_handle_t srcHandle, buffer_handle_t destHandle,
                       const crop_t& destRect, bool filter, bool async) = 0;
+    // queue a blit that starts once inFenceFd signals (-1 for none) and
+    // return at once. inFenceFd stays with the caller, outFenceFd is owned
+    // by the caller and signals when the blit is done
+    virtual bool blitAsync(buffer_handle_t srcHandle, buffer_handle_t destHandle,
+                           const crop_t& destRect, int inFenceFd, int *outFenceFd) = 0;
 protected:
     virtual DataBuffer* createDataBuffer(gralloc_module_t *module,
                                              buffer_handle_t handle) = 0;
     virtual BufferMapper* createBufferMapper(gralloc_module_t *module,
                                                  DataBuffer& buffer) = 0;
+    // allocation stamp of a gralloc buffer, same as the key of its data buffer
+    virtual uint64_t getBufferKey(buffer_handle_t handle) = 0;
 
     gralloc_module_t *mGrallocModule;
 private:
@@ -79,6 +92,7 @@ private:
     BufferCache *mBufferPool;
     DataBuffer *mDataBuffer;
     Mutex mDataBufferLock;
+    BufferMetadataCache mMetadataCache;
     Mutex mLock;
     bool mInitialized;
 };
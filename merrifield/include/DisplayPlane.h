@@ -87,6 +87,8 @@ public:
 
     // data source
     virtual bool setDataBuffer(buffer_handle_t handle);
+    // buffer programmed by the last successful setDataBuffer
+    virtual buffer_handle_t getDataBuffer() const { return mCurrentDataBuffer; }
 
     virtual void invalidateBufferCache();
 
@@ -40,17 +40,40 @@ struct ZOrderLayer
     HwcLayer *hwcLayer;
 };
 
-class ZOrderConfig : public SortedVector<ZOrderLayer*> {
+// Z order config passed to plane managers. It is a fixed capacity list of
+// ZOrderLayer pointers sorted from z order 0 to n, so building it during
+// plane assignment never touches the heap.
+class ZOrderConfig {
 public:
-    ZOrderConfig() {}
-
-    int do_compare(const void* lhs, const void* rhs) const {
-        const ZOrderLayer *l = *(ZOrderLayer**)lhs;
-        const ZOrderLayer *r = *(ZOrderLayer**)rhs;
-
-        // sorted from z order 0 to n
-        return l->zorder - r->zorder;
+    enum {
+        MAX_LAYERS = 32,
+    };
+
+    ZOrderConfig() : mCount(0) {}
+
+    size_t size() const { return mCount; }
+    ZOrderLayer* itemAt(size_t index) const { return mLayers[index]; }
+    ZOrderLayer* operator[](size_t index) const { return mLayers[index]; }
+    void clear() { mCount = 0; }
+
+    bool add(ZOrderLayer *layer) {
+        if (mCount >= MAX_LAYERS) {
+            return false;
+        }
+        // insertion sort, stable for layers with the same z order
+        size_t i = mCount;
+        while (i > 0 && mLayers[i - 1]->zorder > layer->zorder) {
+            mLayers[i] = mLayers[i - 1];
+            i--;
+        }
+        mLayers[i] = layer;
+        mCount++;
+        return true;
     }
+
+private:
+    ZOrderLayer *mLayers[MAX_LAYERS];
+    size_t mCount;
 };
 
 
@@ -65,9 +88,24 @@ public:
 
     virtual bool isValidZOrder(int dsp, ZOrderConfig& config) = 0;
     virtual bool assignPlanes(int dsp, ZOrderConfig& config) = 0;
+    // dry run of assignPlanes, no plane is taken or programmed
+    virtual bool testPlanes(int dsp, ZOrderConfig& config);
     // TODO: remove this API
     virtual void* getZOrderConfig() const = 0;
     virtual int getFreePlanes(int dsp, int type);
+    // bitmap of free and reclaimed planes of the given type
+    uint32_t getFreePlaneMask(int type) const;
+    // bitmap of free and reclaimed planes not reserved for another display
+    uint32_t getPlaneMask(int dsp, int type) const;
+    // bitmap of planes the hardware can route to the display
+    virtual uint32_t getUsablePlanes(int dsp, int type) const;
+
+    // joint plane allocation across displays: each display publishes the
+    // areas of its plane candidates, shared planes are then reserved for
+    // the display that offloads more pixels with them
+    void setPlaneDemand(int dsp, int type, const uint32_t *areas, int count);
+    // returns true if reservation is changed and planes need re-assignment
+    bool balancePlanes();
     virtual void reclaimPlane(int dsp, DisplayPlane& plane);
     virtual void disableReclaimedPlanes();
     virtual bool isOverlayPlanesDisabled();
@@ -83,6 +121,11 @@ protected:
     void putPlane(int index, uint32_t& mask);
     void putPlane(int dsp, DisplayPlane& plane);
     bool isFreePlane(int type, int index);
+    bool isFreePlane(int dsp, int type, int index);
+    // plane affinity statistics, avoided is the number of layers kept on
+    // their last plane only because of the affinity preference
+    void countAffinity(HwcLayer *hwcLayer, DisplayPlane *plane);
+    void countAvoidedMigrations(int count);
     virtual DisplayPlane* allocPlane(int index, int type) = 0;
 
 protected:
@@ -99,11 +142,26 @@ protected:
     uint32_t mFreePlanes[DisplayPlane::PLANE_MAX];
     uint32_t mReclaimedPlanes[DisplayPlane::PLANE_MAX];
 
-    bool mInitialized;
-
 enum {
-    DEFAULT_PRIMARY_PLANE_COUNT = 3
+    DEFAULT_PRIMARY_PLANE_COUNT = 3,
+    // primary and external displays
+    JOINT_DISPLAY_COUNT = 2,
+    MAX_PLANE_DEMAND = 8,
 };
+
+    // joint plane allocation
+    bool mJointAllocation;
+    uint32_t mReservedPlanes[JOINT_DISPLAY_COUNT][DisplayPlane::PLANE_MAX];
+    uint32_t mDemand[JOINT_DISPLAY_COUNT][DisplayPlane::PLANE_MAX][MAX_PLANE_DEMAND];
+    int mDemandCount[JOINT_DISPLAY_COUNT][DisplayPlane::PLANE_MAX];
+    uint32_t mRebalanceCount;
+
+    // plane affinity statistics
+    uint32_t mAffinityKept;
+    uint32_t mAffinityMigrated;
+    uint32_t mAffinityAvoided;
+
+    bool mInitialized;
 };
 
 } // namespace intel
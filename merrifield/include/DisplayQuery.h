@@ -23,6 +23,7 @@ class DisplayQuery
 {
 public:
     static bool isVideoFormat(uint32_t format);
+    static bool isTiledFormat(uint32_t format);
     static int  getOverlayLumaStrideAlignment(uint32_t format);
     static uint32_t queryNV12Format();
 };
@@ -26,6 +26,7 @@
 #include <Drm.h>
 #include <DisplayPlaneManager.h>
 #include <DisplayAnalyzer.h>
+#include <PlaneAssignmentCache.h>
 #include <VsyncManager.h>
 #include <MultiDisplayObserver.h>
 #include <UeventObserver.h>
@@ -79,7 +80,9 @@ public:
     DisplayPlaneManager* getPlaneManager();
     BufferManager* getBufferManager();
     IDisplayContext* getDisplayContext();
+    IVideoPayloadManager* getVideoPayloadManager();
     DisplayAnalyzer* getDisplayAnalyzer();
+    PlaneAssignmentCache* getPlaneAssignmentCache();
     VsyncManager* getVsyncManager();
     MultiDisplayObserver* getMultiDisplayObserver();
     IDisplayDevice* getDisplayDevice(int disp);
@@ -113,6 +116,7 @@ private:
     IPlatFactory *mPlatFactory;
     VsyncManager *mVsyncManager;
     DisplayAnalyzer *mDisplayAnalyzer;
+    PlaneAssignmentCache *mPlaneAssignmentCache;
     MultiDisplayObserver *mMultiDisplayObserver;
     UeventObserver *mUeventObserver;
 
@@ -120,6 +124,7 @@ private:
     DisplayPlaneManager *mPlaneManager;
     BufferManager *mBufferManager;
     IDisplayContext *mDisplayContext;
+    IVideoPayloadManager *mVideoPayloadManager;
 
     Vector<IDisplayDevice*> mDisplayDevices;
 
@@ -85,10 +85,21 @@ public:
 
 protected:
     void onGeometryChanged(hwc_display_contents_1_t *list);
+    // returns true if a geometry change of the list is spurious, i.e. the
+    // layers are structurally identical to those of the last real change
+    bool isGeometrySpurious(hwc_display_contents_1_t *list);
     bool updateDisplayConfigs();
     IVsyncControl* createVsyncControl() {return mControlFactory->createVsyncControl();}
     friend class VsyncEventObserver;
 
+protected:
+    enum {
+        // lists with more layers are never taken as spurious changes
+        GEOMETRY_MAX_LAYERS = 16,
+        GEOMETRY_LAYER_WORDS = 14,
+        GEOMETRY_MAX_WORDS = 2 + GEOMETRY_LAYER_WORDS * GEOMETRY_MAX_LAYERS,
+    };
+
 protected:
     uint32_t mType;
     const char *mName;
@@ -107,6 +118,19 @@ protected:
 
     // layer list
     HwcLayerList *mLayerList;
+
+    // structure of the list at the last real geometry change
+    bool mGeometryFilter;
+    bool mSpuriousGeometry;
+    uint32_t mGeometryHash;
+    size_t mGeometrySize;
+    uint32_t mGeometrySignature[GEOMETRY_MAX_WORDS];
+    uint32_t mRealGeometryChanges;
+    uint32_t mForcedGeometryChanges;
+    uint32_t mSpuriousGeometryChanges;
+    // content rate last passed to the display analyzer
+    uint32_t mContentRate;
+    int mContentCadence;
     bool mConnected;
     bool mBlank;
 
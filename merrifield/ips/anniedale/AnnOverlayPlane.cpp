@@ -178,9 +178,22 @@ bool AnnOverlayPlane::bufferOffsetSetup(BufferMapper& mapper)
     uint32_t uTileOffsetX, uTileOffsetY;
     uint32_t vTileOffsetX, vTileOffsetY;
 
+    if (format == HAL_PIXEL_FORMAT_BGRX_8888 ||
+        format == HAL_PIXEL_FORMAT_BGRA_8888) {
+        // set source format XRGB
+        backBuffer->OCMD = OVERLAY_FORMAT_PLANAR_XRGB;
+        // by pass YUV->RGB conversion, 8-bit output
+        backBuffer->OCONFIG |= OVERLAY_CONFIG_BYPASS_DISABLE;
+        backBuffer->OSTART_0Y = gttOffsetInBytes;
+        backBuffer->OBUF_0Y = srcX * XRGB_BPP + srcY *
+            mapper.getStride().rgb.stride;
+        return true;
+    }
+
     // clear original format setting
     backBuffer->OCMD &= ~(0xf << 10);
     backBuffer->OCMD &= ~OVERLAY_MEMORY_LAYOUT_TILED;
+    backBuffer->OCONFIG &= ~OVERLAY_CONFIG_BYPASS_DISABLE;
 
     backBuffer->OBUF_0Y = 0;
     backBuffer->OBUF_0V = 0;
@@ -301,6 +314,30 @@ bool AnnOverlayPlane::bufferOffsetSetup(BufferMapper& mapper)
     return true;
 }
 
+bool AnnOverlayPlane::coordinateSetup(BufferMapper& mapper)
+{
+    CTRACE();
+
+    uint32_t format = mapper.getFormat();
+    if (format != HAL_PIXEL_FORMAT_BGRX_8888 &&
+        format != HAL_PIXEL_FORMAT_BGRA_8888) {
+        return OverlayPlaneBase::coordinateSetup(mapper);
+    }
+
+    OverlayBackBufferBlk *backBuffer = mBackBuffer[mCurrent]->buf;
+    if (!backBuffer) {
+        ETRACE("invalid back buffer");
+        return false;
+    }
+
+    backBuffer->SWIDTH = mapper.getCrop().w;
+    backBuffer->SHEIGHT = mapper.getCrop().h;
+    backBuffer->OSTRIDE = mapper.getStride().rgb.stride;
+    backBuffer->SWIDTHSW = calculateSWidthSW(backBuffer->OBUF_0Y,
+            backBuffer->OSTRIDE) << 2;
+    return true;
+}
+
 bool AnnOverlayPlane::scalingSetup(BufferMapper& mapper)
 {
     int xscaleInt, xscaleFract, yscaleInt, yscaleFract;
@@ -355,6 +392,7 @@ bool AnnOverlayPlane::scalingSetup(BufferMapper& mapper)
     backBuffer->DWINPOS = (y << 16) | x;
     backBuffer->DWINSZ = (h << 16) | w;
 
+    uint32_t format = mapper.getFormat();
     uint32_t srcWidth = mapper.getCrop().w;
     uint32_t srcHeight = mapper.getCrop().h;
     uint32_t dstWidth = w;
@@ -377,6 +415,11 @@ bool AnnOverlayPlane::scalingSetup(BufferMapper& mapper)
         srcWidth = tmp;
     }
 
+    // XRGB has no subsampled chroma
+    if (format == HAL_PIXEL_FORMAT_BGRX_8888 ||
+        format == HAL_PIXEL_FORMAT_BGRA_8888)
+        uvratio = 1;
+
      // Y down-scale factor as a multiple of 4096
     if (srcWidth == dstWidth && srcHeight == dstHeight) {
         xscaleFract = (1 << 12);
@@ -258,6 +258,16 @@ bool AnnPlaneManager::isValidZOrder(int dsp, ZOrderConfig& config)
 }
 
 bool AnnPlaneManager::assignPlanes(int dsp, ZOrderConfig& config)
+{
+    return matchZOrder(dsp, config, true);
+}
+
+bool AnnPlaneManager::testPlanes(int dsp, ZOrderConfig& config)
+{
+    return matchZOrder(dsp, config, false);
+}
+
+bool AnnPlaneManager::matchZOrder(int dsp, ZOrderConfig& config, bool assign)
 {
     if (dsp < 0 || dsp > IDisplayDevice::DEVICE_EXTERNAL) {
         ETRACE("invalid display device %d", dsp);
@@ -284,21 +294,70 @@ bool AnnPlaneManager::assignPlanes(int dsp, ZOrderConfig& config)
         table = PIPE_B_ZORDER_TBL;
     }
 
+    // among the legitimate combinations prefer the one keeping most layers
+    // on the planes they held last time
+    const char *first = NULL;
+    const char *best = NULL;
+    int firstScore = 0;
+    int bestScore = -1;
     for (int i = 0; i < combinations; i++) {
         ZOrderDescription *zorderDesc = table + i;
 
         if (zorderDesc->index != index)
             continue;
 
-        if (assignPlanes(dsp, config, zorderDesc->zorder)) {
-            VTRACE("zorder assigned %s", zorderDesc->zorder);
+        if (!testPlanes(dsp, config, zorderDesc->zorder)) {
+            continue;
+        }
+
+        if (!assign) {
             return true;
         }
+
+        int score = getAffinityScore(config, zorderDesc->zorder);
+        if (first == NULL) {
+            first = zorderDesc->zorder;
+            firstScore = score;
+        }
+        if (score > bestScore) {
+            best = zorderDesc->zorder;
+            bestScore = score;
+        }
+    }
+
+    if (best && assignPlanes(dsp, config, best)) {
+        VTRACE("zorder assigned %s", best);
+        countAvoidedMigrations(bestScore - firstScore);
+        for (int i = 0; i < size; i++) {
+            countAffinity(config[i]->hwcLayer, config[i]->plane);
+        }
+        return true;
     }
     return false;
 }
 
-bool AnnPlaneManager::assignPlanes(int dsp, ZOrderConfig& config, const char *zorder)
+int AnnPlaneManager::getAffinityScore(ZOrderConfig& config, const char *zorder)
+{
+    int score = 0;
+    int size = (int)config.size();
+    int zorderLen = (int)strlen(zorder);
+    for (int i = 0; i < size && i < zorderLen; i++) {
+        if (config[i]->planeType == DisplayPlane::PLANE_CURSOR) {
+            continue;
+        }
+        DisplayPlane *last = config[i]->hwcLayer->getLastPlane();
+        if (last == NULL) {
+            continue;
+        }
+        PlaneDescription& desc = PLANE_DESC[zorder[i] - 'A'];
+        if (last->getType() == desc.type && last->getIndex() == desc.index) {
+            score++;
+        }
+    }
+    return score;
+}
+
+bool AnnPlaneManager::testPlanes(int dsp, ZOrderConfig& config, const char *zorder)
 {
     // zorder string does not include cursor plane, therefore cursor layer needs to be handled
     // in a special way. Cursor layer must be on top of zorder and no more than one cursor layer.
@@ -319,7 +378,7 @@ bool AnnPlaneManager::assignPlanes(int dsp, ZOrderConfig& config, const char *zo
                 return false;
             }
             PlaneDescription& desc = PLANE_DESC['I' - 'A' + dsp];
-            if (!isFreePlane(desc.type, desc.index)) {
+            if (!isFreePlane(dsp, desc.type, desc.index)) {
                 ETRACE("cursor plane is not available");
                 return false;
             }
@@ -332,7 +391,7 @@ bool AnnPlaneManager::assignPlanes(int dsp, ZOrderConfig& config, const char *zo
 
         char id = *(zorder + i);
         PlaneDescription& desc = PLANE_DESC[id - 'A'];
-        if (!isFreePlane(desc.type, desc.index)) {
+        if (!isFreePlane(dsp, desc.type, desc.index)) {
             DTRACE("plane type %d index %d is not available", desc.type, desc.index);
             return false;
         }
@@ -366,6 +425,17 @@ bool AnnPlaneManager::assignPlanes(int dsp, ZOrderConfig& config, const char *zo
         }
     }
 
+    return true;
+}
+
+bool AnnPlaneManager::assignPlanes(int dsp, ZOrderConfig& config, const char *zorder)
+{
+    // test if plane is avalable
+    if (!testPlanes(dsp, config, zorder)) {
+        return false;
+    }
+
+    int size = (int)config.size();
     bool primaryPlaneActive = false;
     // allocate planes
     for (int i = 0; i < size; i++) {
@@ -439,21 +509,19 @@ int AnnPlaneManager::getFreePlanes(int dsp, int type)
         return 0;
     }
 
-    uint32_t freePlanes = mFreePlanes[type] | mReclaimedPlanes[type];
-    int start = 0;
-    int stop = mSpritePlaneCount;
-    if (dsp == IDisplayDevice::DEVICE_EXTERNAL) {
+    uint32_t freePlanes = getPlaneMask(dsp, type) & getUsablePlanes(dsp, type);
+    return __builtin_popcount(freePlanes);
+}
+
+uint32_t AnnPlaneManager::getUsablePlanes(int dsp, int type) const
+{
+    if (type == DisplayPlane::PLANE_SPRITE &&
+        dsp == IDisplayDevice::DEVICE_EXTERNAL) {
         // only Sprite D (index 0) can be assigned to pipe 1
         // Sprites E/F (index 1, 2) are fixed on pipe 0
-        stop = 1;
-    }
-    int count = 0;
-    for (int i = start; i < stop; i++) {
-        if ((1 << i) & freePlanes) {
-            count++;
-        }
+        return 1;
     }
-    return count;
+    return DisplayPlaneManager::getUsablePlanes(dsp, type);
 }
 
 } // namespace intel
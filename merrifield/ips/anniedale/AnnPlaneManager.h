@@ -32,13 +32,18 @@ public:
     virtual void deinitialize();
     virtual bool isValidZOrder(int dsp, ZOrderConfig& config);
     virtual bool assignPlanes(int dsp, ZOrderConfig& config);
+    virtual bool testPlanes(int dsp, ZOrderConfig& config);
     virtual int getFreePlanes(int dsp, int type);
+    virtual uint32_t getUsablePlanes(int dsp, int type) const;
     // TODO: remove this API
     virtual void* getZOrderConfig() const;
 
 protected:
     DisplayPlane* allocPlane(int index, int type);
     bool assignPlanes(int dsp, ZOrderConfig& config, const char *zorder);
+    bool testPlanes(int dsp, ZOrderConfig& config, const char *zorder);
+    bool matchZOrder(int dsp, ZOrderConfig& config, bool assign);
+    int getAffinityScore(ZOrderConfig& config, const char *zorder);
 };
 
 } // namespace intel
@@ -22,8 +22,6 @@
 #include <PlaneCapabilities.h>
 #include <common/OverlayHardware.h>
 #include <HwcLayer.h>
-#include <BufferManager.h>
-#include <Hwcomposer.h>
 
 
 #define SPRITE_PLANE_MAX_STRIDE_TILED      16384
@@ -54,6 +52,10 @@ bool PlaneCapabilities::isFormatSupported(int planeType, HwcLayer *hwcLayer)
         }
     } else if (planeType == DisplayPlane::PLANE_OVERLAY) {
         switch (format) {
+        case HAL_PIXEL_FORMAT_BGRA_8888:
+        case HAL_PIXEL_FORMAT_BGRX_8888:
+            // XRGB is scanned out with color conversion bypassed
+            return trans ? false : true;
         case HAL_PIXEL_FORMAT_I420:
         case HAL_PIXEL_FORMAT_YUY2:
         case HAL_PIXEL_FORMAT_UYVY:
@@ -106,6 +108,13 @@ bool PlaneCapabilities::isSizeSupported(int planeType, HwcLayer *hwcLayer)
         }
     } else if (planeType == DisplayPlane::PLANE_OVERLAY) {
         switch (format) {
+        case HAL_PIXEL_FORMAT_BGRA_8888:
+        case HAL_PIXEL_FORMAT_BGRX_8888:
+            if (stride.rgb.stride > OVERLAY_PLANE_MAX_STRIDE_PACKED) {
+                VTRACE("too large stride %d", stride.rgb.stride);
+                return false;
+            }
+            return true;
         case HAL_PIXEL_FORMAT_YV12:
         case HAL_PIXEL_FORMAT_I420:
         case HAL_PIXEL_FORMAT_NV12:
@@ -132,7 +141,7 @@ bool PlaneCapabilities::isSizeSupported(int planeType, HwcLayer *hwcLayer)
             return false;
         }
 
-        hwc_frect_t& srcCrop = hwcLayer->getLayer()->sourceCropf;
+        const hwc_frect_t& srcCrop = hwcLayer->getClippedCrop();
         uint32_t width = srcCrop.right - srcCrop.left;
         uint32_t height = srcCrop.bottom - srcCrop.top;
 
@@ -183,8 +192,9 @@ bool PlaneCapabilities::isBlendingSupported(int planeType, HwcLayer *hwcLayer)
 
 bool PlaneCapabilities::isScalingSupported(int planeType, HwcLayer *hwcLayer)
 {
-    hwc_frect_t& src = hwcLayer->getLayer()->sourceCropf;
-    hwc_rect_t& dest = hwcLayer->getLayer()->displayFrame;
+    // planes are programmed with the part of the layer inside the screen
+    const hwc_frect_t& src = hwcLayer->getClippedCrop();
+    const hwc_rect_t& dest = hwcLayer->getClippedFrame();
     uint32_t trans = hwcLayer->getLayer()->transform;
 
     int srcW, srcH;
@@ -225,8 +235,12 @@ bool PlaneCapabilities::isScalingSupported(int planeType, HwcLayer *hwcLayer)
             srcH = tmp;
         }
 
+        uint32_t format = hwcLayer->getFormat();
+        bool isRGB = (format == HAL_PIXEL_FORMAT_BGRA_8888 ||
+                      format == HAL_PIXEL_FORMAT_BGRX_8888);
         if (!hwcLayer->isProtected()) {
-            if ((int)src.left & 63) {
+            // XRGB is never rotated, its offset is in 4-byte pixels
+            if (!isRGB && ((int)src.left & 63)) {
                 DTRACE("offset %d is not 64 bytes aligned, fall back to GLES", (int)src.left);
                 return false;
             }
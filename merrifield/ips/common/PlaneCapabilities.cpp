@@ -170,8 +170,9 @@ bool PlaneCapabilities::isBlendingSupported(int planeType, HwcLayer *hwcLayer)
 
 bool PlaneCapabilities::isScalingSupported(int planeType, HwcLayer *hwcLayer)
 {
-    hwc_frect_t& src = hwcLayer->getLayer()->sourceCropf;
-    hwc_rect_t& dest = hwcLayer->getLayer()->displayFrame;
+    // planes are programmed with the part of the layer inside the screen
+    const hwc_frect_t& src = hwcLayer->getClippedCrop();
+    const hwc_rect_t& dest = hwcLayer->getClippedFrame();
 
     int srcW, srcH;
     int dstW, dstH;
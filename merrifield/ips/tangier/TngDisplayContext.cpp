@@ -223,10 +223,13 @@ bool TngDisplayContext::commitEnd(size_t numDisplays, hwc_display_contents_1_t *
         // dup releaseFenceFd for physical displays and ignore virtual
         // display; we don't distinguish between release and retire, and all
         // physical displays are using a single releaseFence; for virtual
-        // display, fencing is handled by the VirtualDisplay class
+        // display, fencing is handled by the VirtualDisplay class.
+        // A display with no layer posted, e.g. a deferred video frame,
+        // gets no retire fence rather than the one of another pipe
         if (i < IDisplayDevice::DEVICE_VIRTUAL) {
             displays[i]->retireFenceFd =
-                (releaseFenceFd != -1) ? dup(releaseFenceFd) : -1;
+                (releaseFenceFd != -1 && isPosted(displays[i])) ?
+                    dup(releaseFenceFd) : -1;
         }
     }
 
@@ -237,6 +240,20 @@ bool TngDisplayContext::commitEnd(size_t numDisplays, hwc_display_contents_1_t *
     return true;
 }
 
+bool TngDisplayContext::isPosted(hwc_display_contents_1_t *display) const
+{
+    const hwc_layer_1_t *first = &display->hwLayers[0];
+    const hwc_layer_1_t *end = first + display->numHwLayers;
+
+    for (size_t i = 0; i < mCount; i++) {
+        const hwc_layer_1_t *layer = mImgLayers[i].psLayer;
+        if (layer >= first && layer < end) {
+            return true;
+        }
+    }
+    return false;
+}
+
 bool TngDisplayContext::compositionComplete()
 {
     return true;
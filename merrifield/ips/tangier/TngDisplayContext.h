@@ -49,6 +49,10 @@ public:
     bool compositionComplete();
     bool setCursorPosition(int disp, int x, int y);
 
+private:
+    // true if a layer of the display is in the layers to post
+    bool isPosted(hwc_display_contents_1_t *display) const;
+
 private:
     enum {
         MAXIMUM_LAYER_NUMBER = 20,
@@ -39,6 +39,11 @@ bool DisplayQuery::isVideoFormat(uint32_t format)
     }
 }
 
+bool DisplayQuery::isTiledFormat(uint32_t format)
+{
+    return format == OMX_INTEL_COLOR_FormatYUV420PackedSemiPlanar_Tiled;
+}
+
 int DisplayQuery::getOverlayLumaStrideAlignment(uint32_t format)
 {
     // both luma and chroma stride need to be 64-byte aligned for overlay
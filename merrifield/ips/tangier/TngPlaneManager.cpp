@@ -137,12 +137,13 @@ bool TngPlaneManager::assignPlanes(int dsp, ZOrderConfig& config)
     // allocate planes
     for (int i = 0; i < size; i++) {
         ZOrderLayer *layer = config.itemAt(i);
-        layer->plane = getPlaneHelper(dsp, layer->planeType);
+        layer->plane = getPlaneHelper(dsp, layer->planeType, layer->hwcLayer);
         if (layer->plane == NULL) {
             // should never happen!!
             ETRACE("failed to assign plane for type %d", layer->planeType);
             return false;
         }
+        countAffinity(layer->hwcLayer, layer->plane);
         // sequence !!!!! enabling plane before setting zorder
         // see TngSpritePlane::enablePlane implementation!!!!
         layer->plane->enable();
@@ -162,7 +163,7 @@ void* TngPlaneManager::getZOrderConfig() const
     return (void*)&mZorder;
 }
 
-DisplayPlane* TngPlaneManager::getPlaneHelper(int dsp, int type)
+DisplayPlane* TngPlaneManager::getPlaneHelper(int dsp, int type, HwcLayer *hwcLayer)
 {
     RETURN_NULL_IF_NOT_INIT();
 
@@ -176,19 +177,42 @@ DisplayPlane* TngPlaneManager::getPlaneHelper(int dsp, int type)
     if (type == DisplayPlane::PLANE_PRIMARY ||
         type == DisplayPlane::PLANE_CURSOR) {
         return getPlane(type, index);
-    } else if (type == DisplayPlane::PLANE_SPRITE) {
-        return getAnyPlane(type);
+    }
+
+    // default choice, skipping planes reserved for the other display
+    int choice = -1;
+    if (type == DisplayPlane::PLANE_SPRITE) {
+        for (int i = 0; i < mSpritePlaneCount; i++) {
+            if (isFreePlane(dsp, type, i)) {
+                choice = i;
+                break;
+            }
+        }
     } else if (type == DisplayPlane::PLANE_OVERLAY) {
         // use overlay A for pipe A and overlay C for pipe B if possible
-        DisplayPlane *plane = getPlane(type, index);
-        if (plane == NULL) {
-            plane = getPlane(type, !index);
+        if (isFreePlane(dsp, type, index)) {
+            choice = index;
+        } else if (isFreePlane(dsp, type, !index)) {
+            choice = !index;
         }
-        return plane;
     } else {
         ETRACE("invalid plane type %d", type);
         return 0;
     }
+
+    if (choice < 0) {
+        return 0;
+    }
+
+    // prefer the plane the layer held last time to avoid a plane migration
+    DisplayPlane *last = hwcLayer ? hwcLayer->getLastPlane() : NULL;
+    if (last && last->getType() == type && last->getIndex() != choice &&
+        isFreePlane(dsp, type, last->getIndex())) {
+        choice = last->getIndex();
+        countAvoidedMigrations(1);
+    }
+
+    return getPlane(type, choice);
 }
 
 } // namespace intel
@@ -37,7 +37,7 @@ public:
 
 protected:
     DisplayPlane* allocPlane(int index, int type);
-    DisplayPlane* getPlaneHelper(int dsp, int type);
+    DisplayPlane* getPlaneHelper(int dsp, int type, HwcLayer *hwcLayer);
 
 private:
     struct intel_dc_plane_zorder mZorder;
@@ -27,11 +27,19 @@ LOCAL_SRC_FILES := \
     ../../common/base/Drm.cpp \
     ../../common/base/HwcLayer.cpp \
     ../../common/base/HwcLayerList.cpp \
+    ../../common/base/OverlapMatrix.cpp \
     ../../common/base/Hwcomposer.cpp \
     ../../common/base/HwcModule.cpp \
     ../../common/base/DisplayAnalyzer.cpp \
+    ../../common/base/PlaneAssignmentCache.cpp \
+    ../../common/base/RefreshRatePolicy.cpp \
+    ../../common/base/StaticLayerCache.cpp \
+    ../../common/base/VideoActivityTracker.cpp \
+    ../../common/base/CadenceTracker.cpp \
+    ../../common/base/VideoPacer.cpp \
     ../../common/base/VsyncManager.cpp \
     ../../common/buffers/BufferCache.cpp \
+    ../../common/buffers/BufferMetadataCache.cpp \
     ../../common/buffers/GraphicBuffer.cpp \
     ../../common/buffers/BufferManager.cpp \
     ../../common/devices/PhysicalDevice.cpp \
@@ -44,7 +52,9 @@ LOCAL_SRC_FILES := \
     ../../common/observers/MultiDisplayObserver.cpp \
     ../../common/planes/DisplayPlane.cpp \
     ../../common/planes/DisplayPlaneManager.cpp \
-    ../../common/utils/Dump.cpp
+    ../../common/utils/Dump.cpp \
+    ../../common/utils/RectClip.cpp \
+    ../../common/utils/VisibleRegion.cpp
 
 
 LOCAL_SRC_FILES += \
@@ -59,6 +59,11 @@ BufferMapper* PlatfBufferManager::createBufferMapper(gralloc_module_t *module,
                                         buffer);
 }
 
+uint64_t PlatfBufferManager::getBufferKey(buffer_handle_t handle)
+{
+    return ((TngIMGGrallocBuffer *)handle)->ui64Stamp;
+}
+
 bool PlatfBufferManager::blit(buffer_handle_t srcHandle, buffer_handle_t destHandle,
                               const crop_t& destRect, bool filter, bool async)
 
@@ -92,5 +97,28 @@ bool PlatfBufferManager::blit(buffer_handle_t srcHandle, buffer_handle_t destHan
     return true;
 }
 
+bool PlatfBufferManager::blitAsync(buffer_handle_t srcHandle, buffer_handle_t destHandle,
+                                   const crop_t& destRect, int inFenceFd, int *outFenceFd)
+{
+    *outFenceFd = -1;
+#ifdef ASUS_ZENFONE2_LP_BLOBS
+    // this gralloc neither takes nor returns fences
+    VTRACE("fenced blit is not supported");
+    return false;
+#else
+    IMG_gralloc_module_public_t *imgGrallocModule = (IMG_gralloc_module_public_t *) mGrallocModule;
+
+    if (imgGrallocModule->Blit(imgGrallocModule, srcHandle,
+                                destHandle,
+                                destRect.w, destRect.h, destRect.x,
+                                destRect.y, 0, inFenceFd, outFenceFd)) {
+        ETRACE("Blit failed");
+        return false;
+    }
+
+    return true;
+#endif
+}
+
 } // namespace intel
 } // namespace android
@@ -34,8 +34,11 @@ protected:
     DataBuffer* createDataBuffer(gralloc_module_t *module, buffer_handle_t handle);
     BufferMapper* createBufferMapper(gralloc_module_t *module,
                                         DataBuffer& buffer);
+    uint64_t getBufferKey(buffer_handle_t handle);
     bool blit(buffer_handle_t srcHandle, buffer_handle_t destHandle,
               const crop_t& destRect, bool filter, bool async);
+    bool blitAsync(buffer_handle_t srcHandle, buffer_handle_t destHandle,
+                   const crop_t& destRect, int inFenceFd, int *outFenceFd);
 };
 
 }
@@ -24,3 +24,109 @@ LOCAL_C_INCLUDES := \
 # Build the binary to $(TARGET_OUT_DATA_NATIVE_TESTS)/$(LOCAL_MODULE)
 # to integrate with auto-test framework.
 include $(BUILD_EXECUTABLE)
+
+# Micro-benchmarks of the layer list hot loops, each one also checks the
+# fast path against the code it replaces.
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := hwc_layer_bench
+
+LOCAL_MODULE_TAGS := tests
+
+LOCAL_SRC_FILES := \
+    overlap_matrix_bench.cpp \
+    layer_table_bench.cpp \
+    HwcLayerTable.cpp \
+    ../common/base/OverlapMatrix.cpp \
+
+LOCAL_SHARED_LIBRARIES := \
+	libcutils \
+	liblog \
+	libutils \
+
+LOCAL_STATIC_LIBRARIES := \
+	libgtest \
+	libgtest_main \
+
+LOCAL_C_INCLUDES := \
+    $(call include-path-for, gtest) \
+    $(LOCAL_PATH) \
+    $(LOCAL_PATH)/../include \
+    $(LOCAL_PATH)/../common/base \
+    $(LOCAL_PATH)/../common/utils \
+
+include $(BUILD_EXECUTABLE)
+
+# Host independent unit tests of the pure logic helpers.
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := hwc_unit_test
+
+LOCAL_MODULE_TAGS := tests
+
+LOCAL_SRC_FILES := \
+    visible_region_test.cpp \
+    rect_clip_test.cpp \
+    refresh_rate_policy_test.cpp \
+    buffer_metadata_cache_test.cpp \
+    ../common/utils/VisibleRegion.cpp \
+    ../common/utils/RectClip.cpp \
+    ../common/utils/Dump.cpp \
+    ../common/base/CadenceTracker.cpp \
+    ../common/base/RefreshRatePolicy.cpp \
+    ../common/buffers/BufferMetadataCache.cpp \
+
+LOCAL_SHARED_LIBRARIES := \
+	libcutils \
+	liblog \
+	libutils \
+
+LOCAL_STATIC_LIBRARIES := \
+	libgtest \
+	libgtest_main \
+
+LOCAL_C_INCLUDES := \
+    $(call include-path-for, gtest) \
+    $(LOCAL_PATH)/../include \
+    $(LOCAL_PATH)/../common/base \
+    $(LOCAL_PATH)/../common/buffers \
+    $(LOCAL_PATH)/../common/utils \
+
+include $(BUILD_EXECUTABLE)
+
+# Anniedale plane capability checks, run against a stand-in HwcLayer from
+# fake/ so they don't need a display or gralloc buffers.
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := hwc_plane_caps_test
+
+LOCAL_MODULE_TAGS := tests
+
+LOCAL_SRC_FILES := \
+    plane_capabilities_test.cpp \
+    ../ips/anniedale/PlaneCapabilities.cpp \
+
+LOCAL_SHARED_LIBRARIES := \
+	libcutils \
+	liblog \
+	libutils \
+
+LOCAL_STATIC_LIBRARIES := \
+	libgtest \
+	libgtest_main \
+
+LOCAL_C_INCLUDES := \
+    $(call include-path-for, gtest) \
+    $(LOCAL_PATH)/fake \
+    frameworks/native/include/media/openmax \
+    $(TARGET_OUT_HEADERS)/khronos/openmax \
+    $(TARGET_OUT_HEADERS)/drm \
+    $(TARGET_OUT_HEADERS)/libdrm \
+    $(TARGET_OUT_HEADERS)/libdrm/shared-core \
+    $(LOCAL_PATH)/../include \
+    $(LOCAL_PATH)/../include/pvr/hal \
+    $(LOCAL_PATH)/../common/base \
+    $(LOCAL_PATH)/../common/utils \
+    $(LOCAL_PATH)/../ips \
+
+include $(BUILD_EXECUTABLE)
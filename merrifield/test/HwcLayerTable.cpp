@@ -0,0 +1,116 @@
+/*
+// Copyright (c) 2014 Intel Corporation 
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+#include <HwcTrace.h>
+#include <HwcLayerTable.h>
+
+namespace android {
+namespace intel {
+
+HwcLayerTable::HwcLayerTable()
+    : left(NULL),
+      top(NULL),
+      right(NULL),
+      bottom(NULL),
+      compositionType(NULL),
+      blending(NULL),
+      flags(NULL),
+      transform(NULL),
+      format(NULL),
+      bpp(NULL),
+      staticCount(NULL),
+      planeAlpha(NULL),
+      handle(NULL),
+      updated(NULL),
+      fb(NULL),
+      mCount(0),
+      mCapacity(0),
+      mStorage(NULL)
+{
+}
+
+HwcLayerTable::~HwcLayerTable()
+{
+    delete [] mStorage;
+}
+
+bool HwcLayerTable::resize(int count)
+{
+    if (count < 0) {
+        ETRACE("invalid layer count %d", count);
+        return false;
+    }
+
+    if (count > mCapacity) {
+        // one block for all arrays, word arrays first to keep them aligned
+        int bytes = (count * BYTE_ARRAYS + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+        uint32_t *storage = new uint32_t[count * WORD_ARRAYS + bytes];
+        if (!storage) {
+            ETRACE("failed to allocate layer table");
+            return false;
+        }
+        delete [] mStorage;
+        mStorage = storage;
+        mCapacity = count;
+
+        uint32_t *words = mStorage;
+        left = (int32_t *)words;
+        top = (int32_t *)(words += count);
+        right = (int32_t *)(words += count);
+        bottom = (int32_t *)(words += count);
+        compositionType = (int32_t *)(words += count);
+        blending = (int32_t *)(words += count);
+        flags = (words += count);
+        transform = (words += count);
+        format = (words += count);
+        bpp = (words += count);
+        staticCount = (words += count);
+
+        uint8_t *bytesArray = (uint8_t *)(words + count);
+        planeAlpha = bytesArray;
+        handle = (bytesArray += count);
+        updated = (bytesArray += count);
+        fb = (bytesArray += count);
+    }
+
+    mCount = count;
+    return true;
+}
+
+void HwcLayerTable::load(hwc_display_contents_1_t *list)
+{
+    int count = (int)list->numHwLayers;
+    if (count > mCount) {
+        ETRACE("layer count %d exceeds table size %d", count, mCount);
+        count = mCount;
+    }
+
+    for (int i = 0; i < count; i++) {
+        const hwc_layer_1_t& layer = list->hwLayers[i];
+        left[i] = layer.displayFrame.left;
+        top[i] = layer.displayFrame.top;
+        right[i] = layer.displayFrame.right;
+        bottom[i] = layer.displayFrame.bottom;
+        compositionType[i] = layer.compositionType;
+        blending[i] = layer.blending;
+        flags[i] = layer.flags;
+        transform[i] = layer.transform;
+        planeAlpha[i] = layer.planeAlpha;
+        handle[i] = layer.handle ? 1 : 0;
+    }
+}
+
+} // namespace intel
+} // namespace android
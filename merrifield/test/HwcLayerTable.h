@@ -0,0 +1,93 @@
+/*
+// Copyright (c) 2014 Intel Corporation 
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+#ifndef HWC_LAYER_TABLE_H
+#define HWC_LAYER_TABLE_H
+
+#include <hardware/hwcomposer.h>
+
+namespace android {
+namespace intel {
+
+// Per-frame structure of arrays copy of the layer attributes read by the
+// loops over a layer list. Each attribute is a dense array indexed by layer
+// index, so a loop touching a few attributes of every layer streams through
+// contiguous memory instead of chasing HwcLayer and hwc_layer_1_t pointers.
+// Only used by layer_table_bench to compare against the pointer loops.
+class HwcLayerTable {
+public:
+    HwcLayerTable();
+    virtual ~HwcLayerTable();
+
+public:
+    // grow the storage to hold count layers, storage is never shrunk
+    bool resize(int count);
+    int size() const { return mCount; }
+    // copy the attributes of the hwc layers, layer state kept by HwcLayer
+    // (format, update and frame buffer flags) is filled in by the caller
+    void load(hwc_display_contents_1_t *list);
+
+    bool isOpaque(int index) const {
+        return compositionType[index] == HWC_FRAMEBUFFER &&
+               !(flags[index] & HWC_SKIP_LAYER) &&
+               handle[index] &&
+               blending[index] == HWC_BLENDING_NONE &&
+               planeAlpha[index] == 0xff;
+    }
+
+    bool intersects(int a, int b) const {
+        return right[b] > left[a] &&
+               left[b] < right[a] &&
+               top[b] < bottom[a] &&
+               bottom[b] > top[a];
+    }
+
+public:
+    // display frame
+    int32_t *left;
+    int32_t *top;
+    int32_t *right;
+    int32_t *bottom;
+    int32_t *compositionType;
+    int32_t *blending;
+    uint32_t *flags;
+    uint32_t *transform;
+    uint32_t *format;
+    // bits per pixel
+    uint32_t *bpp;
+    uint32_t *staticCount;
+    uint8_t *planeAlpha;
+    // non-zero if the layer has a buffer
+    uint8_t *handle;
+    uint8_t *updated;
+    // non-zero if the layer is composed to frame buffer target
+    uint8_t *fb;
+
+private:
+    enum {
+        WORD_ARRAYS = 11,
+        BYTE_ARRAYS = 4,
+    };
+
+    int mCount;
+    int mCapacity;
+    uint32_t *mStorage;
+};
+
+} // namespace intel
+} // namespace android
+
+
+#endif /* HWC_LAYER_TABLE_H */
@@ -0,0 +1,197 @@
+/*
+// Copyright (c) 2014 Intel Corporation 
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+#include <gtest/gtest.h>
+
+#include <pthread.h>
+#include <string.h>
+
+#include <cutils/atomic.h>
+#include <BufferMetadataCache.h>
+
+using namespace android::intel;
+
+namespace {
+
+// every field of a record is derived from its allocation stamp, so a
+// reader can tell a record that mixes two writes apart from a whole one
+BufferMetadata makeMeta(buffer_handle_t handle, uint64_t key)
+{
+    BufferMetadata meta;
+    memset(&meta, 0, sizeof(meta));
+    meta.handle = handle;
+    meta.key = key;
+    meta.format = (uint32_t)(key * 7);
+    meta.width = (uint32_t)(key + 1);
+    meta.height = (uint32_t)(key + 2);
+    meta.stride.rgb.stride = (uint32_t)(key + 3);
+    meta.usage = (uint32_t)(key ^ 0x5a5a);
+    meta.bpp = (uint32_t)(key & 31);
+    meta.isTiled = (key & 1) != 0;
+    meta.isProtected = (key & 2) != 0;
+    meta.isCompressed = (key & 4) != 0;
+    return meta;
+}
+
+bool isWhole(const BufferMetadata& meta)
+{
+    BufferMetadata expected = makeMeta(meta.handle, meta.key);
+    return meta.format == expected.format &&
+           meta.width == expected.width &&
+           meta.height == expected.height &&
+           meta.stride.rgb.stride == expected.stride.rgb.stride &&
+           meta.usage == expected.usage &&
+           meta.bpp == expected.bpp &&
+           meta.isTiled == expected.isTiled &&
+           meta.isProtected == expected.isProtected &&
+           meta.isCompressed == expected.isCompressed;
+}
+
+buffer_handle_t fakeHandle(int i)
+{
+    // handles are heap pointers, keep them 16 byte aligned
+    return (buffer_handle_t)(uintptr_t)(0x10000 + i * 0x40);
+}
+
+class BufferMetadataCacheTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        mCache.initialize();
+    }
+
+    virtual void TearDown() {
+        mCache.deinitialize();
+    }
+
+    BufferMetadataCache mCache;
+};
+
+TEST_F(BufferMetadataCacheTest, MissThenHit)
+{
+    BufferMetadata meta;
+    EXPECT_FALSE(mCache.lookup(fakeHandle(1), 1, meta));
+
+    mCache.insert(makeMeta(fakeHandle(1), 1));
+    ASSERT_TRUE(mCache.lookup(fakeHandle(1), 1, meta));
+    EXPECT_EQ(fakeHandle(1), meta.handle);
+    EXPECT_TRUE(isWhole(meta));
+    EXPECT_FALSE(mCache.lookup(fakeHandle(2), 1, meta));
+}
+
+TEST_F(BufferMetadataCacheTest, ReallocatedHandleMisses)
+{
+    BufferMetadata meta;
+    mCache.insert(makeMeta(fakeHandle(1), 1));
+    EXPECT_FALSE(mCache.lookup(fakeHandle(1), 2, meta));
+
+    mCache.insert(makeMeta(fakeHandle(1), 2));
+    ASSERT_TRUE(mCache.lookup(fakeHandle(1), 2, meta));
+    EXPECT_EQ(2u, meta.key);
+    EXPECT_FALSE(mCache.lookup(fakeHandle(1), 1, meta));
+}
+
+TEST_F(BufferMetadataCacheTest, NotInitialized)
+{
+    BufferMetadata meta;
+    mCache.insert(makeMeta(fakeHandle(1), 1));
+    mCache.deinitialize();
+    EXPECT_FALSE(mCache.lookup(fakeHandle(1), 1, meta));
+    mCache.insert(makeMeta(fakeHandle(1), 1));
+    EXPECT_FALSE(mCache.lookup(fakeHandle(1), 1, meta));
+}
+
+// One writer keeps reallocating more handles than the cache holds, so
+// slots are refilled and evicted under the readers. A reader looks up the
+// latest stamp of a handle and checks that a hit is never a torn record.
+struct StressState {
+    enum {
+        HANDLES = BufferMetadataCache::CACHE_SIZE * 2,
+        WRITES = 200000,
+        READERS = 4,
+    };
+
+    BufferMetadataCache *cache;
+    volatile int32_t keys[HANDLES];
+    volatile int32_t done;
+    int32_t hits[READERS];
+    int32_t torn[READERS];
+};
+
+struct ReaderArgs {
+    StressState *state;
+    int reader;
+};
+
+void *writerLoop(void *arg)
+{
+    StressState *state = (StressState *)arg;
+    for (int i = 0; i < StressState::WRITES; i++) {
+        int h = (i * 7) % StressState::HANDLES;
+        int32_t key = i + 1;
+        state->cache->insert(makeMeta(fakeHandle(h), key));
+        android_atomic_release_store(key, &state->keys[h]);
+    }
+    android_atomic_release_store(1, &state->done);
+    return NULL;
+}
+
+void *readerLoop(void *arg)
+{
+    ReaderArgs *args = (ReaderArgs *)arg;
+    StressState *state = args->state;
+    uint32_t h = args->reader;
+    while (!android_atomic_acquire_load(&state->done)) {
+        h = (h * 1103515245 + 12345) % StressState::HANDLES;
+        int32_t key = android_atomic_acquire_load(&state->keys[h]);
+        BufferMetadata meta;
+        if (!key || !state->cache->lookup(fakeHandle(h), key, meta)) {
+            continue;
+        }
+        state->hits[args->reader]++;
+        if (meta.handle != fakeHandle(h) || meta.key != (uint64_t)key ||
+            !isWhole(meta)) {
+            state->torn[args->reader]++;
+        }
+    }
+    return NULL;
+}
+
+TEST_F(BufferMetadataCacheTest, OneWriterManyReaders)
+{
+    StressState state;
+    memset(&state, 0, sizeof(state));
+    state.cache = &mCache;
+
+    pthread_t readers[StressState::READERS];
+    ReaderArgs args[StressState::READERS];
+    for (int i = 0; i < StressState::READERS; i++) {
+        args[i].state = &state;
+        args[i].reader = i;
+        ASSERT_EQ(0, pthread_create(&readers[i], NULL, readerLoop, &args[i]));
+    }
+    pthread_t writer;
+    ASSERT_EQ(0, pthread_create(&writer, NULL, writerLoop, &state));
+
+    pthread_join(writer, NULL);
+    int hits = 0;
+    for (int i = 0; i < StressState::READERS; i++) {
+        pthread_join(readers[i], NULL);
+        hits += state.hits[i];
+        EXPECT_EQ(0, state.torn[i]) << "reader " << i;
+    }
+    EXPECT_GT(hits, 0);
+}
+
+} // namespace
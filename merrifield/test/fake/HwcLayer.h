@@ -0,0 +1,84 @@
+/*
+// Copyright (c) 2014 Intel Corporation 
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+#ifndef HWC_LAYER_H
+#define HWC_LAYER_H
+
+#include <string.h>
+#include <hardware/hwcomposer.h>
+#include <DataBuffer.h>
+
+namespace android {
+namespace intel {
+
+// Stand-in for the composer layer with just the accessors the plane
+// capability checks read, so the checks can be tested without a display.
+class HwcLayer {
+public:
+    HwcLayer()
+        : mFormat(0),
+          mWidth(0),
+          mHeight(0),
+          mIsProtected(false)
+    {
+        memset(&mLayer, 0, sizeof(mLayer));
+        memset(&mStride, 0, sizeof(mStride));
+        memset(&mClippedFrame, 0, sizeof(mClippedFrame));
+        memset(&mClippedCrop, 0, sizeof(mClippedCrop));
+        mLayer.blending = HWC_BLENDING_NONE;
+        mLayer.planeAlpha = 0xff;
+    }
+
+    // a buffer of the given size and format shown at the given frame
+    void setup(uint32_t format, uint32_t width, uint32_t height,
+               const hwc_frect_t& crop, const hwc_rect_t& frame)
+    {
+        mFormat = format;
+        mWidth = width;
+        mHeight = height;
+        mStride.rgb.stride = width * 4;
+        mLayer.sourceCropf = crop;
+        mLayer.displayFrame = frame;
+        mClippedCrop = crop;
+        mClippedFrame = frame;
+    }
+    void setStride(const stride_t& stride) { mStride = stride; }
+    void setProtected(bool isProtected) { mIsProtected = isProtected; }
+
+    uint32_t getFormat() const { return mFormat; }
+    uint32_t getBufferWidth() const { return mWidth; }
+    uint32_t getBufferHeight() const { return mHeight; }
+    const stride_t& getBufferStride() const { return mStride; }
+    uint32_t getTransform() const { return mLayer.transform; }
+    bool isProtected() const { return mIsProtected; }
+    hwc_layer_1_t* getLayer() const { return const_cast<hwc_layer_1_t*>(&mLayer); }
+    const hwc_rect_t& getClippedFrame() const { return mClippedFrame; }
+    const hwc_frect_t& getClippedCrop() const { return mClippedCrop; }
+
+private:
+    hwc_layer_1_t mLayer;
+    uint32_t mFormat;
+    uint32_t mWidth;
+    uint32_t mHeight;
+    stride_t mStride;
+    bool mIsProtected;
+    hwc_rect_t mClippedFrame;
+    hwc_frect_t mClippedCrop;
+};
+
+} // namespace intel
+} // namespace android
+
+#endif /* HWC_LAYER_H */
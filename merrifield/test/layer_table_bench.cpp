@@ -0,0 +1,325 @@
+/*
+// Copyright (c) 2014 Intel Corporation 
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include <utils/Timers.h>
+#include <HwcLayerTable.h>
+
+using namespace android::intel;
+
+namespace {
+
+// The per-layer loops of HwcLayerList, run once over heap allocated layer
+// objects pointing into the hwc list as HwcLayerList does, and once over
+// HwcLayerTable arrays. The table gave no speedup on the host, so the
+// layer list does not use it; it is kept here to be measured again.
+
+enum {
+    STATIC_THRESHOLD = 10,
+    // frame buffer subsets priced per frame by the plane assignment
+    SUBSETS = 64,
+};
+
+// the HwcLayer state the loops read
+struct Layer {
+    hwc_layer_1_t *layer;
+    uint32_t format;
+    uint32_t bpp;
+    uint32_t staticCount;
+    bool updated;
+    bool fb;
+};
+
+class LayerList {
+public:
+    LayerList(int count, uint32_t seed)
+        : mCount(count)
+    {
+        size_t size = sizeof(hwc_display_contents_1_t) + count * sizeof(hwc_layer_1_t);
+        mList = (hwc_display_contents_1_t *)calloc(1, size);
+        mList->numHwLayers = count;
+
+        for (int i = 0; i < count; i++) {
+            hwc_layer_1_t& hwcLayer = mList->hwLayers[i];
+            int w = 64 + next(seed) % 1856;
+            int h = 64 + next(seed) % 1016;
+            hwcLayer.displayFrame.left = next(seed) % (1920 - w + 1);
+            hwcLayer.displayFrame.top = next(seed) % (1080 - h + 1);
+            hwcLayer.displayFrame.right = hwcLayer.displayFrame.left + w;
+            hwcLayer.displayFrame.bottom = hwcLayer.displayFrame.top + h;
+            hwcLayer.compositionType = HWC_FRAMEBUFFER;
+            hwcLayer.blending = (next(seed) % 2) ? HWC_BLENDING_PREMULT : HWC_BLENDING_NONE;
+            hwcLayer.planeAlpha = 0xff;
+            hwcLayer.handle = (buffer_handle_t)(uintptr_t)(i + 1);
+
+            // scatter the layer objects over the heap like HwcLayer
+            Layer *layer = new Layer;
+            mPadding.push_back(malloc(64 + next(seed) % 512));
+            layer->layer = &hwcLayer;
+            layer->format = HAL_PIXEL_FORMAT_RGBA_8888;
+            layer->bpp = (next(seed) % 4) ? 32 : 16;
+            layer->staticCount = next(seed) % (2 * STATIC_THRESHOLD);
+            layer->updated = (next(seed) % 4) == 0;
+            layer->fb = (next(seed) % 3) != 0;
+            mLayers.push_back(layer);
+        }
+
+        for (int s = 0; s < SUBSETS; s++) {
+            mSubsets.push_back(next(seed) & all());
+        }
+    }
+
+    ~LayerList() {
+        for (size_t i = 0; i < mLayers.size(); i++) {
+            delete mLayers[i];
+            free(mPadding[i]);
+        }
+        free(mList);
+    }
+
+    int size() const { return mCount; }
+    uint32_t all() const {
+        return (mCount == 32) ? 0xffffffff : ((1U << mCount) - 1);
+    }
+    uint32_t subset(int s) const { return mSubsets[s]; }
+
+    // per-frame fill of the table from the hwc list and the layers
+    void load(HwcLayerTable& table) const {
+        table.resize(mCount);
+        table.load(mList);
+        for (int i = 0; i < mCount; i++) {
+            const Layer *layer = mLayers[i];
+            table.format[i] = layer->format;
+            table.bpp[i] = layer->bpp;
+            table.updated[i] = layer->updated ? 1 : 0;
+            table.staticCount[i] = layer->staticCount;
+            table.fb[i] = layer->fb ? 1 : 0;
+        }
+    }
+
+    // setupSmartComposition and the opaque checks of cullLayers
+    uint32_t scanSlow() const {
+        uint32_t result = 0;
+        for (int i = 0; i < mCount; i++) {
+            const Layer *layer = mLayers[i];
+            const hwc_layer_1_t *l = layer->layer;
+            if (layer->fb &&
+                (layer->updated || layer->staticCount == STATIC_THRESHOLD)) {
+                result |= 1;
+            }
+            if (l->compositionType == HWC_FRAMEBUFFER &&
+                !(l->flags & HWC_SKIP_LAYER) &&
+                l->handle &&
+                l->blending == HWC_BLENDING_NONE &&
+                l->planeAlpha == 0xff) {
+                result += 2;
+            }
+        }
+        return result;
+    }
+
+    // getLayerBytes
+    uint64_t bytesSlow(uint32_t layers) const {
+        uint64_t bytes = 0;
+        while (layers) {
+            int i = __builtin_ctz(layers);
+            layers &= ~(1U << i);
+            const hwc_rect_t& frame = mLayers[i]->layer->displayFrame;
+            uint64_t area = (uint64_t)(frame.right - frame.left) *
+                            (uint64_t)(frame.bottom - frame.top);
+            bytes += (area * mLayers[i]->bpp) >> 3;
+        }
+        return bytes;
+    }
+
+private:
+    static uint32_t next(uint32_t& seed) {
+        seed = seed * 1103515245 + 12345;
+        return seed >> 8;
+    }
+
+private:
+    int mCount;
+    hwc_display_contents_1_t *mList;
+    std::vector<Layer *> mLayers;
+    std::vector<void *> mPadding;
+    std::vector<uint32_t> mSubsets;
+};
+
+uint32_t scanFast(const HwcLayerTable& table)
+{
+    uint32_t result = 0;
+    for (int i = 0; i < table.size(); i++) {
+        if (table.fb[i] &&
+            (table.updated[i] || table.staticCount[i] == STATIC_THRESHOLD)) {
+            result |= 1;
+        }
+        if (table.isOpaque(i)) {
+            result += 2;
+        }
+    }
+    return result;
+}
+
+uint64_t bytesFast(const HwcLayerTable& table, uint32_t layers)
+{
+    uint64_t bytes = 0;
+    while (layers) {
+        int i = __builtin_ctz(layers);
+        layers &= ~(1U << i);
+        uint64_t area = (uint64_t)(table.right[i] - table.left[i]) *
+                        (uint64_t)(table.bottom[i] - table.top[i]);
+        bytes += (area * table.bpp[i]) >> 3;
+    }
+    return bytes;
+}
+
+uint64_t frameSlow(const LayerList& list)
+{
+    uint64_t sink = list.scanSlow();
+    for (int s = 0; s < SUBSETS; s++) {
+        sink += list.bytesSlow(list.subset(s));
+    }
+    return sink;
+}
+
+uint64_t frameFast(const LayerList& list, HwcLayerTable& table)
+{
+    list.load(table);
+    uint64_t sink = scanFast(table);
+    for (int s = 0; s < SUBSETS; s++) {
+        sink += bytesFast(table, list.subset(s));
+    }
+    return sink;
+}
+
+const int LAYER_COUNTS[] = { 4, 8, 16, 32 };
+const int LISTS = 256;
+const int ROUNDS = 200;
+
+} // namespace
+
+TEST(HwcLayerTableTest, MatchesPointerLoops)
+{
+    HwcLayerTable table;
+    for (size_t c = 0; c < sizeof(LAYER_COUNTS) / sizeof(LAYER_COUNTS[0]); c++) {
+        for (int l = 0; l < 64; l++) {
+            LayerList list(LAYER_COUNTS[c], l + 1);
+            EXPECT_EQ(frameSlow(list), frameFast(list, table))
+                << LAYER_COUNTS[c] << " layers, list " << l;
+        }
+    }
+}
+
+// One frame: the attribute scan over every layer plus the bandwidth of
+// SUBSETS frame buffer subsets. The table side includes loading the table.
+TEST(HwcLayerTableBench, FrameLoops)
+{
+    HwcLayerTable table;
+    printf("layers | pointer loops ns | table load ns | table loops ns\n");
+    for (size_t c = 0; c < sizeof(LAYER_COUNTS) / sizeof(LAYER_COUNTS[0]); c++) {
+        std::vector<LayerList *> lists;
+        for (int l = 0; l < LISTS; l++) {
+            lists.push_back(new LayerList(LAYER_COUNTS[c], l + 1));
+        }
+
+        // the sink keeps the loops from being optimized out
+        volatile uint64_t sink = 0;
+        nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+        for (int r = 0; r < ROUNDS; r++) {
+            for (int l = 0; l < LISTS; l++) {
+                sink += frameSlow(*lists[l]);
+            }
+        }
+        nsecs_t slow = systemTime(SYSTEM_TIME_MONOTONIC) - start;
+
+        start = systemTime(SYSTEM_TIME_MONOTONIC);
+        for (int r = 0; r < ROUNDS; r++) {
+            for (int l = 0; l < LISTS; l++) {
+                lists[l]->load(table);
+                sink += table.left[0];
+            }
+        }
+        nsecs_t load = systemTime(SYSTEM_TIME_MONOTONIC) - start;
+
+        start = systemTime(SYSTEM_TIME_MONOTONIC);
+        for (int r = 0; r < ROUNDS; r++) {
+            for (int l = 0; l < LISTS; l++) {
+                sink += frameFast(*lists[l], table);
+            }
+        }
+        nsecs_t fast = systemTime(SYSTEM_TIME_MONOTONIC) - start;
+        (void)sink;
+
+        int calls = ROUNDS * LISTS;
+        printf("%6d | %16lld | %13lld | %14lld\n", LAYER_COUNTS[c],
+               (long long)(slow / calls), (long long)(load / calls),
+               (long long)((fast - load) / calls));
+
+        for (int l = 0; l < LISTS; l++) {
+            delete lists[l];
+        }
+    }
+}
+
+// Same frame with the caches cold, as prepare runs once per vsync after
+// the rest of the system has had the CPU. Each frame is timed alone.
+TEST(HwcLayerTableBench, ColdFrameLoops)
+{
+    const size_t evictBytes = 16 * 1024 * 1024;
+    std::vector<uint8_t> evict(evictBytes, 1);
+    HwcLayerTable table;
+    printf("layers | pointer loops ns | table load + loops ns\n");
+    for (size_t c = 0; c < sizeof(LAYER_COUNTS) / sizeof(LAYER_COUNTS[0]); c++) {
+        std::vector<LayerList *> lists;
+        for (int l = 0; l < LISTS; l++) {
+            lists.push_back(new LayerList(LAYER_COUNTS[c], l + 1));
+        }
+
+        volatile uint64_t sink = 0;
+        nsecs_t slow = 0;
+        nsecs_t fast = 0;
+        const int frames = 64;
+        for (int f = 0; f < frames; f++) {
+            const LayerList& list = *lists[f % LISTS];
+            for (size_t b = 0; b < evictBytes; b += 64) {
+                evict[b]++;
+            }
+            nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+            sink += frameSlow(list);
+            slow += systemTime(SYSTEM_TIME_MONOTONIC) - start;
+
+            for (size_t b = 0; b < evictBytes; b += 64) {
+                evict[b]++;
+            }
+            start = systemTime(SYSTEM_TIME_MONOTONIC);
+            sink += frameFast(list, table);
+            fast += systemTime(SYSTEM_TIME_MONOTONIC) - start;
+        }
+        (void)sink;
+
+        printf("%6d | %16lld | %21lld\n", LAYER_COUNTS[c],
+               (long long)(slow / frames), (long long)(fast / frames));
+
+        for (int l = 0; l < LISTS; l++) {
+            delete lists[l];
+        }
+    }
+}
@@ -0,0 +1,258 @@
+/*
+// Copyright (c) 2014 Intel Corporation 
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include <utils/Timers.h>
+#include <OverlapMatrix.h>
+
+using namespace android::intel;
+
+namespace {
+
+// Frame buffer target Z order search of HwcLayerList: every frame buffer
+// layer is tried as the target, once with the nested rectangle loops over
+// heap allocated layers it used to run and once with OverlapMatrix rows.
+
+struct Layer {
+    hwc_layer_1_t *layer;
+    bool candidate;
+};
+
+class LayerList {
+public:
+    enum {
+        // windows of random size and position on a 1920x1080 screen
+        LAYOUT_WINDOWS,
+        // 8x4 grid of tiles, nothing overlaps and no check exits early
+        LAYOUT_TILES,
+    };
+
+    LayerList(int count, uint32_t seed, int layout)
+        : mCount(count),
+          mCandidates(0)
+    {
+        size_t size = sizeof(hwc_display_contents_1_t) + count * sizeof(hwc_layer_1_t);
+        mList = (hwc_display_contents_1_t *)calloc(1, size);
+        mList->numHwLayers = count;
+
+        for (int i = 0; i < count; i++) {
+            hwc_rect_t& frame = mList->hwLayers[i].displayFrame;
+            if (layout == LAYOUT_TILES) {
+                frame.left = (i % 8) * 240;
+                frame.top = ((i / 8) % 4) * 270;
+                frame.right = frame.left + 240;
+                frame.bottom = frame.top + 270;
+            } else {
+                int w = 64 + next(seed) % 1856;
+                int h = 64 + next(seed) % 1016;
+                frame.left = next(seed) % (1920 - w + 1);
+                frame.top = next(seed) % (1080 - h + 1);
+                frame.right = frame.left + w;
+                frame.bottom = frame.top + h;
+            }
+
+            // scatter the layer objects over the heap like HwcLayer
+            Layer *layer = new Layer;
+            mPadding.push_back(malloc(64 + next(seed) % 512));
+            layer->layer = &mList->hwLayers[i];
+            layer->candidate = (next(seed) % 3) == 0;
+            if (layer->candidate) {
+                mCandidates |= 1U << i;
+            }
+            mLayers.push_back(layer);
+        }
+    }
+
+    ~LayerList() {
+        for (size_t i = 0; i < mLayers.size(); i++) {
+            delete mLayers[i];
+            free(mPadding[i]);
+        }
+        free(mList);
+    }
+
+    hwc_display_contents_1_t *list() { return mList; }
+    int size() const { return mCount; }
+    uint32_t candidates() const { return mCandidates; }
+
+    // useAsFrameBufferTargetSlow
+    bool canTargetSlow(int target) const {
+        for (int below = 0; below < target; below++) {
+            if (mLayers[below]->candidate) {
+                continue;
+            }
+            for (int above = below + 1; above < target; above++) {
+                if (mLayers[above]->candidate &&
+                    intersects(mLayers[above], mLayers[below])) {
+                    return false;
+                }
+            }
+        }
+        for (int above = target + 1; above < mCount; above++) {
+            if (mLayers[above]->candidate) {
+                continue;
+            }
+            for (int below = target + 1; below < above; below++) {
+                if (mLayers[below]->candidate &&
+                    intersects(mLayers[above], mLayers[below])) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+private:
+    static uint32_t next(uint32_t& seed) {
+        seed = seed * 1103515245 + 12345;
+        return seed >> 8;
+    }
+
+    static bool intersects(const Layer *a, const Layer *b) {
+        const hwc_rect_t& ra = a->layer->displayFrame;
+        const hwc_rect_t& rb = b->layer->displayFrame;
+        return rb.right > ra.left && rb.left < ra.right &&
+               rb.top < ra.bottom && rb.bottom > ra.top;
+    }
+
+private:
+    int mCount;
+    uint32_t mCandidates;
+    hwc_display_contents_1_t *mList;
+    std::vector<Layer *> mLayers;
+    std::vector<void *> mPadding;
+};
+
+void buildMatrix(LayerList& list, OverlapMatrix& overlap)
+{
+    overlap.build(list.list());
+}
+
+uint32_t searchFast(LayerList& list, const OverlapMatrix& overlap)
+{
+    uint32_t all = (list.size() == 32) ? 0xffffffff : ((1U << list.size()) - 1);
+    uint32_t candidates = list.candidates();
+    uint32_t noncandidates = all & ~candidates;
+    uint32_t targets = 0;
+    for (int i = 0; i < list.size(); i++) {
+        if (overlap.canMerge(noncandidates & ~(1U << i), candidates, i)) {
+            targets |= 1U << i;
+        }
+    }
+    return targets;
+}
+
+uint32_t searchSlow(LayerList& list)
+{
+    uint32_t targets = 0;
+    for (int i = 0; i < list.size(); i++) {
+        if (list.canTargetSlow(i)) {
+            targets |= 1U << i;
+        }
+    }
+    return targets;
+}
+
+const int LAYER_COUNTS[] = { 8, 16, 32 };
+const int LAYOUTS[] = { LayerList::LAYOUT_WINDOWS, LayerList::LAYOUT_TILES };
+const char *LAYOUT_NAMES[] = { "windows", "tiles" };
+const int LISTS = 64;
+const int ROUNDS = 200;
+
+} // namespace
+
+TEST(OverlapMatrixTest, MatchesNestedLoops)
+{
+    OverlapMatrix overlap;
+    for (int layout = 0; layout < 2; layout++) {
+        for (size_t c = 0; c < sizeof(LAYER_COUNTS) / sizeof(LAYER_COUNTS[0]); c++) {
+            for (int l = 0; l < LISTS; l++) {
+                LayerList list(LAYER_COUNTS[c], l + 1, LAYOUTS[layout]);
+                buildMatrix(list, overlap);
+                EXPECT_EQ(searchSlow(list), searchFast(list, overlap))
+                    << LAYOUT_NAMES[layout] << ", " << LAYER_COUNTS[c]
+                    << " layers, list " << l;
+            }
+        }
+    }
+}
+
+TEST(OverlapMatrixTest, TooManyLayers)
+{
+    OverlapMatrix overlap;
+    LayerList list(OverlapMatrix::MAX_LAYERS + 1, 1, LayerList::LAYOUT_WINDOWS);
+    EXPECT_FALSE(overlap.build(list.list()));
+    EXPECT_FALSE(overlap.isValid());
+}
+
+// The matrix is built once per layer list, the target search runs on every
+// branch of the plane assignment, so both costs are reported per call.
+TEST(OverlapMatrixBench, TargetSearch)
+{
+    OverlapMatrix overlap;
+    printf("layout  | layers | nested loops ns | matrix build ns | matrix search ns\n");
+    for (int layout = 0; layout < 2; layout++) {
+        for (size_t c = 0; c < sizeof(LAYER_COUNTS) / sizeof(LAYER_COUNTS[0]); c++) {
+            std::vector<LayerList *> lists;
+            for (int l = 0; l < LISTS; l++) {
+                lists.push_back(new LayerList(LAYER_COUNTS[c], l + 1, LAYOUTS[layout]));
+            }
+
+            // the sink keeps the searches from being optimized out
+            volatile uint32_t sink = 0;
+            nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+            for (int r = 0; r < ROUNDS; r++) {
+                for (int l = 0; l < LISTS; l++) {
+                    sink ^= searchSlow(*lists[l]);
+                }
+            }
+            nsecs_t slow = systemTime(SYSTEM_TIME_MONOTONIC) - start;
+
+            start = systemTime(SYSTEM_TIME_MONOTONIC);
+            for (int r = 0; r < ROUNDS; r++) {
+                for (int l = 0; l < LISTS; l++) {
+                    buildMatrix(*lists[l], overlap);
+                    sink ^= overlap.row(0);
+                }
+            }
+            nsecs_t build = systemTime(SYSTEM_TIME_MONOTONIC) - start;
+
+            buildMatrix(*lists[0], overlap);
+            start = systemTime(SYSTEM_TIME_MONOTONIC);
+            for (int r = 0; r < ROUNDS; r++) {
+                for (int l = 0; l < LISTS; l++) {
+                    sink ^= searchFast(*lists[l], overlap);
+                }
+            }
+            nsecs_t fast = systemTime(SYSTEM_TIME_MONOTONIC) - start;
+            (void)sink;
+
+            int calls = ROUNDS * LISTS;
+            printf("%-7s | %6d | %15lld | %15lld | %16lld\n",
+                   LAYOUT_NAMES[layout], LAYER_COUNTS[c],
+                   (long long)(slow / calls), (long long)(build / calls),
+                   (long long)(fast / calls));
+
+            for (int l = 0; l < LISTS; l++) {
+                delete lists[l];
+            }
+        }
+    }
+}
@@ -0,0 +1,163 @@
+/*
+// Copyright (c) 2014 Intel Corporation 
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+#include <gtest/gtest.h>
+
+#include <HwcLayer.h>
+#include <DisplayPlane.h>
+#include <PlaneCapabilities.h>
+#include <hal_public.h>
+
+using namespace android::intel;
+
+namespace {
+
+hwc_rect_t rect(int left, int top, int right, int bottom)
+{
+    hwc_rect_t r = { left, top, right, bottom };
+    return r;
+}
+
+hwc_frect_t frect(float left, float top, float right, float bottom)
+{
+    hwc_frect_t r = { left, top, right, bottom };
+    return r;
+}
+
+const uint32_t RGB_FORMATS[] = {
+    HAL_PIXEL_FORMAT_BGRA_8888,
+    HAL_PIXEL_FORMAT_BGRX_8888,
+};
+
+// a 960x540 buffer scaled up to 1920x1080 on the overlay, its 3840 byte
+// stride is within the packed stride limit
+void setupScaled(HwcLayer& layer, uint32_t format)
+{
+    layer.setup(format, 960, 540, frect(0, 0, 960, 540), rect(0, 0, 1920, 1080));
+}
+
+bool overlaySupported(HwcLayer& layer)
+{
+    const int type = DisplayPlane::PLANE_OVERLAY;
+    return PlaneCapabilities::isFormatSupported(type, &layer) &&
+           PlaneCapabilities::isSizeSupported(type, &layer) &&
+           PlaneCapabilities::isBlendingSupported(type, &layer) &&
+           PlaneCapabilities::isScalingSupported(type, &layer) &&
+           PlaneCapabilities::isTransformSupported(type, &layer);
+}
+
+} // namespace
+
+TEST(PlaneCapabilitiesTest, OverlayAcceptsScaledXRGB)
+{
+    for (size_t i = 0; i < sizeof(RGB_FORMATS) / sizeof(RGB_FORMATS[0]); i++) {
+        HwcLayer layer;
+        setupScaled(layer, RGB_FORMATS[i]);
+        EXPECT_TRUE(overlaySupported(layer)) << std::hex << RGB_FORMATS[i];
+    }
+}
+
+TEST(PlaneCapabilitiesTest, OverlayRejectsOtherRGBFormats)
+{
+    const uint32_t formats[] = {
+        HAL_PIXEL_FORMAT_RGBA_8888,
+        HAL_PIXEL_FORMAT_RGBX_8888,
+        HAL_PIXEL_FORMAT_RGB_565,
+    };
+    for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); i++) {
+        HwcLayer layer;
+        setupScaled(layer, formats[i]);
+        EXPECT_FALSE(PlaneCapabilities::isFormatSupported(DisplayPlane::PLANE_OVERLAY, &layer))
+            << std::hex << formats[i];
+        // sprites still take them
+        EXPECT_TRUE(PlaneCapabilities::isFormatSupported(DisplayPlane::PLANE_SPRITE, &layer))
+            << std::hex << formats[i];
+    }
+}
+
+TEST(PlaneCapabilitiesTest, OverlayRejectsTransformedXRGB)
+{
+    const uint32_t transforms[] = {
+        HAL_TRANSFORM_FLIP_H, HAL_TRANSFORM_FLIP_V, HAL_TRANSFORM_ROT_90,
+        HAL_TRANSFORM_ROT_180, HAL_TRANSFORM_ROT_270,
+    };
+    for (size_t i = 0; i < sizeof(RGB_FORMATS) / sizeof(RGB_FORMATS[0]); i++) {
+        for (size_t t = 0; t < sizeof(transforms) / sizeof(transforms[0]); t++) {
+            HwcLayer layer;
+            setupScaled(layer, RGB_FORMATS[i]);
+            layer.getLayer()->transform = transforms[t];
+            EXPECT_FALSE(PlaneCapabilities::isFormatSupported(DisplayPlane::PLANE_OVERLAY, &layer))
+                << std::hex << RGB_FORMATS[i] << " transform " << transforms[t];
+        }
+    }
+}
+
+TEST(PlaneCapabilitiesTest, OverlayXRGBStrideLimit)
+{
+    for (size_t i = 0; i < sizeof(RGB_FORMATS) / sizeof(RGB_FORMATS[0]); i++) {
+        HwcLayer layer;
+        setupScaled(layer, RGB_FORMATS[i]);
+        stride_t stride;
+
+        // 1024 pixels of XRGB is the packed stride limit
+        stride.rgb.stride = 4096;
+        layer.setStride(stride);
+        EXPECT_TRUE(PlaneCapabilities::isSizeSupported(DisplayPlane::PLANE_OVERLAY, &layer));
+
+        stride.rgb.stride = 4096 + 64;
+        layer.setStride(stride);
+        EXPECT_FALSE(PlaneCapabilities::isSizeSupported(DisplayPlane::PLANE_OVERLAY, &layer));
+        EXPECT_TRUE(PlaneCapabilities::isSizeSupported(DisplayPlane::PLANE_SPRITE, &layer));
+    }
+}
+
+TEST(PlaneCapabilitiesTest, OverlayOffsetRuleOnlyForYUV)
+{
+    // source crop starting 8 pixels in, which is not 64 byte aligned for
+    // the Y plane but is a plain 32 byte offset for XRGB
+    HwcLayer rgb;
+    rgb.setup(HAL_PIXEL_FORMAT_BGRX_8888, 1280, 720,
+              frect(8, 0, 1288, 720), rect(0, 0, 1920, 1080));
+    EXPECT_TRUE(PlaneCapabilities::isScalingSupported(DisplayPlane::PLANE_OVERLAY, &rgb));
+
+    HwcLayer yuv;
+    yuv.setup(HAL_PIXEL_FORMAT_NV12, 1280, 720,
+              frect(8, 0, 1288, 720), rect(0, 0, 1920, 1080));
+    EXPECT_FALSE(PlaneCapabilities::isScalingSupported(DisplayPlane::PLANE_OVERLAY, &yuv));
+}
+
+TEST(PlaneCapabilitiesTest, OverlayXRGBScalingLimits)
+{
+    HwcLayer layer;
+
+    // downscaling by 3 or more is out of range
+    layer.setup(HAL_PIXEL_FORMAT_BGRA_8888, 1920, 1080,
+                frect(0, 0, 1920, 1080), rect(0, 0, 640, 360));
+    EXPECT_FALSE(PlaneCapabilities::isScalingSupported(DisplayPlane::PLANE_OVERLAY, &layer));
+
+    // destination too narrow for the overlay
+    layer.setup(HAL_PIXEL_FORMAT_BGRA_8888, 200, 200,
+                frect(0, 0, 200, 200), rect(0, 0, 100, 100));
+    EXPECT_FALSE(PlaneCapabilities::isScalingSupported(DisplayPlane::PLANE_OVERLAY, &layer));
+}
+
+TEST(PlaneCapabilitiesTest, OverlayXRGBNeedsOpaqueBlending)
+{
+    HwcLayer layer;
+    setupScaled(layer, HAL_PIXEL_FORMAT_BGRA_8888);
+    layer.getLayer()->blending = HWC_BLENDING_PREMULT;
+    EXPECT_FALSE(PlaneCapabilities::isBlendingSupported(DisplayPlane::PLANE_OVERLAY, &layer));
+    EXPECT_TRUE(PlaneCapabilities::isBlendingSupported(DisplayPlane::PLANE_SPRITE, &layer));
+}
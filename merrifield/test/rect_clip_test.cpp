@@ -0,0 +1,210 @@
+/*
+// Copyright (c) 2014 Intel Corporation 
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+#include <gtest/gtest.h>
+
+#include <math.h>
+
+#include <RectClip.h>
+
+using namespace android::intel;
+
+namespace {
+
+const hwc_rect_t SCREEN = { 0, 0, 1920, 1080 };
+
+hwc_rect_t rect(int left, int top, int right, int bottom)
+{
+    hwc_rect_t r = { left, top, right, bottom };
+    return r;
+}
+
+hwc_frect_t frect(float left, float top, float right, float bottom)
+{
+    hwc_frect_t r = { left, top, right, bottom };
+    return r;
+}
+
+struct Vector {
+    const char *name;
+    uint32_t transform;
+    hwc_rect_t frame;
+    hwc_frect_t crop;
+    hwc_rect_t bounds;
+    int alignment;
+    hwc_rect_t clippedFrame;
+    hwc_frect_t clippedCrop;
+};
+
+// A 100x50 frame sticking out 20 pixels left and 10 pixels above the
+// screen, with a 2x downscale. Expected crops follow the HAL order: the
+// buffer is flipped first and then rotated 90 degrees clockwise.
+const Vector VECTORS[] = {
+    { "ROT_0", 0,
+      { -20, -10, 80, 40 }, { 0, 0, 200, 100 }, SCREEN, 1,
+      { 0, 0, 80, 40 }, { 40, 20, 200, 100 } },
+    { "FLIP_H", HAL_TRANSFORM_FLIP_H,
+      { -20, -10, 80, 40 }, { 0, 0, 200, 100 }, SCREEN, 1,
+      { 0, 0, 80, 40 }, { 0, 20, 160, 100 } },
+    { "FLIP_V", HAL_TRANSFORM_FLIP_V,
+      { -20, -10, 80, 40 }, { 0, 0, 200, 100 }, SCREEN, 1,
+      { 0, 0, 80, 40 }, { 40, 0, 200, 80 } },
+    { "ROT_180", HAL_TRANSFORM_ROT_180,
+      { -20, -10, 80, 40 }, { 0, 0, 200, 100 }, SCREEN, 1,
+      { 0, 0, 80, 40 }, { 0, 0, 160, 80 } },
+    // buffer left edge is shown at the display top, buffer bottom at the
+    // display left
+    { "ROT_90", HAL_TRANSFORM_ROT_90,
+      { -20, -10, 80, 40 }, { 0, 0, 100, 200 }, SCREEN, 1,
+      { 0, 0, 80, 40 }, { 20, 0, 100, 160 } },
+    // buffer right edge is shown at the display top, buffer top at the
+    // display left
+    { "ROT_270", HAL_TRANSFORM_ROT_270,
+      { -20, -10, 80, 40 }, { 0, 0, 100, 200 }, SCREEN, 1,
+      { 0, 0, 80, 40 }, { 0, 40, 80, 200 } },
+    { "ROT_90 | FLIP_H", HAL_TRANSFORM_ROT_90 | HAL_TRANSFORM_FLIP_H,
+      { -20, -10, 80, 40 }, { 0, 0, 100, 200 }, SCREEN, 1,
+      { 0, 0, 80, 40 }, { 0, 0, 80, 160 } },
+    { "ROT_90 | FLIP_V", HAL_TRANSFORM_ROT_90 | HAL_TRANSFORM_FLIP_V,
+      { -20, -10, 80, 40 }, { 0, 0, 100, 200 }, SCREEN, 1,
+      { 0, 0, 80, 40 }, { 20, 40, 100, 200 } },
+    // right and bottom edges, no scaling
+    { "ROT_0 bottom right", 0,
+      { 1900, 1060, 1940, 1100 }, { 10, 10, 50, 50 }, SCREEN, 1,
+      { 1900, 1060, 1920, 1080 }, { 10, 10, 30, 30 } },
+    // odd cuts snap outwards to even crop edges for subsampled YUV
+    { "snap left", 0,
+      { -3, 0, 97, 50 }, { 0, 0, 100, 50 }, SCREEN, 2,
+      { 0, 0, 97, 50 }, { 2, 0, 100, 50 } },
+    { "snap right", 0,
+      { 1823, 0, 1923, 50 }, { 0, 0, 100, 50 }, SCREEN, 2,
+      { 1823, 0, 1920, 50 }, { 0, 0, 98, 50 } },
+    // snapping never grows the crop beyond the original one
+    { "snap inside crop", 0,
+      { 0, 0, 100, 50 }, { 1, 0, 101, 50 }, rect(0, 0, 99, 50), 2,
+      { 0, 0, 99, 50 }, { 1, 0, 100, 50 } },
+};
+
+void expectRect(const hwc_rect_t& expected, const hwc_rect_t& actual, const char *name)
+{
+    EXPECT_EQ(expected.left, actual.left) << name;
+    EXPECT_EQ(expected.top, actual.top) << name;
+    EXPECT_EQ(expected.right, actual.right) << name;
+    EXPECT_EQ(expected.bottom, actual.bottom) << name;
+}
+
+void expectFRect(const hwc_frect_t& expected, const hwc_frect_t& actual, const char *name)
+{
+    EXPECT_FLOAT_EQ(expected.left, actual.left) << name;
+    EXPECT_FLOAT_EQ(expected.top, actual.top) << name;
+    EXPECT_FLOAT_EQ(expected.right, actual.right) << name;
+    EXPECT_FLOAT_EQ(expected.bottom, actual.bottom) << name;
+}
+
+// buffer position in [0, 1] of a display position in [0, 1] of the frame
+void toBuffer(uint32_t transform, float dx, float dy, float& bx, float& by)
+{
+    if (transform & HAL_TRANSFORM_ROT_90) {
+        bx = dy;
+        by = 1.0f - dx;
+    } else {
+        bx = dx;
+        by = dy;
+    }
+    if (transform & HAL_TRANSFORM_FLIP_H) {
+        bx = 1.0f - bx;
+    }
+    if (transform & HAL_TRANSFORM_FLIP_V) {
+        by = 1.0f - by;
+    }
+}
+
+} // namespace
+
+TEST(RectClipTest, TransformVectors)
+{
+    for (size_t i = 0; i < sizeof(VECTORS) / sizeof(VECTORS[0]); i++) {
+        const Vector& v = VECTORS[i];
+        hwc_rect_t frame;
+        hwc_frect_t crop;
+        ASSERT_TRUE(RectClip::clip(v.frame, v.crop, v.transform, v.bounds,
+                                   v.alignment, frame, crop)) << v.name;
+        expectRect(v.clippedFrame, frame, v.name);
+        expectFRect(v.clippedCrop, crop, v.name);
+    }
+}
+
+TEST(RectClipTest, InsideBounds)
+{
+    hwc_rect_t frame;
+    hwc_frect_t crop;
+    hwc_rect_t in = rect(10, 10, 110, 60);
+    hwc_frect_t inCrop = frect(0.5f, 0.5f, 99.5f, 49.5f);
+    EXPECT_FALSE(RectClip::isClipped(in, SCREEN));
+    ASSERT_TRUE(RectClip::clip(in, inCrop, HAL_TRANSFORM_ROT_90, SCREEN, 2, frame, crop));
+    expectRect(in, frame, "inside");
+    expectFRect(inCrop, crop, "inside");
+}
+
+TEST(RectClipTest, OffScreen)
+{
+    hwc_rect_t frame;
+    hwc_frect_t crop;
+    EXPECT_TRUE(RectClip::isClipped(rect(-100, 0, 0, 50), SCREEN));
+    EXPECT_FALSE(RectClip::clip(rect(-100, 0, 0, 50), frect(0, 0, 100, 50),
+                                0, SCREEN, 1, frame, crop));
+    EXPECT_FALSE(RectClip::clip(rect(0, 1080, 100, 1200), frect(0, 0, 100, 120),
+                                0, SCREEN, 1, frame, crop));
+    EXPECT_FALSE(RectClip::clip(rect(0, 0, 0, 50), frect(0, 0, 100, 50),
+                                0, SCREEN, 1, frame, crop));
+}
+
+TEST(RectClipTest, MatchesReferenceMapping)
+{
+    // every transform and every edge combination, checked against the
+    // corners of the visible part mapped back into the buffer
+    const uint32_t transforms[] = {
+        0, HAL_TRANSFORM_FLIP_H, HAL_TRANSFORM_FLIP_V, HAL_TRANSFORM_ROT_180,
+        HAL_TRANSFORM_ROT_90, HAL_TRANSFORM_ROT_90 | HAL_TRANSFORM_FLIP_H,
+        HAL_TRANSFORM_ROT_90 | HAL_TRANSFORM_FLIP_V, HAL_TRANSFORM_ROT_270,
+    };
+    const hwc_rect_t frames[] = {
+        rect(-40, 0, 160, 100), rect(0, -30, 200, 70), rect(1800, 0, 2000, 100),
+        rect(0, 1000, 200, 1100), rect(-50, -25, 150, 75), rect(1850, 1030, 2050, 1130),
+    };
+    const hwc_frect_t crop = frect(8, 16, 408, 216);
+
+    for (size_t t = 0; t < sizeof(transforms) / sizeof(transforms[0]); t++) {
+        for (size_t f = 0; f < sizeof(frames) / sizeof(frames[0]); f++) {
+            const hwc_rect_t& in = frames[f];
+            hwc_rect_t frame;
+            hwc_frect_t out;
+            ASSERT_TRUE(RectClip::clip(in, crop, transforms[t], SCREEN, 1, frame, out));
+
+            float w = in.right - in.left;
+            float h = in.bottom - in.top;
+            float x0, y0, x1, y1;
+            toBuffer(transforms[t], (frame.left - in.left) / w, (frame.top - in.top) / h, x0, y0);
+            toBuffer(transforms[t], (frame.right - in.left) / w, (frame.bottom - in.top) / h, x1, y1);
+            float cw = crop.right - crop.left;
+            float ch = crop.bottom - crop.top;
+
+            EXPECT_NEAR(crop.left + fminf(x0, x1) * cw, out.left, 0.01f) << t << " " << f;
+            EXPECT_NEAR(crop.top + fminf(y0, y1) * ch, out.top, 0.01f) << t << " " << f;
+            EXPECT_NEAR(crop.left + fmaxf(x0, x1) * cw, out.right, 0.01f) << t << " " << f;
+            EXPECT_NEAR(crop.top + fmaxf(y0, y1) * ch, out.bottom, 0.01f) << t << " " << f;
+        }
+    }
+}
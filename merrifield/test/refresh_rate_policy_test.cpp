@@ -0,0 +1,195 @@
+/*
+// Copyright (c) 2014 Intel Corporation 
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+#include <gtest/gtest.h>
+
+#include <CadenceTracker.h>
+#include <RefreshRatePolicy.h>
+
+using namespace android::intel;
+
+namespace {
+
+// modes of a TV at 1080p, in the order the connector lists them
+const uint32_t TV_RATES[] = { 60, 50, 30, 24, 60 };
+const int TV_RATE_COUNT = sizeof(TV_RATES) / sizeof(TV_RATES[0]);
+const uint32_t SORTED_RATES[] = { 24, 30, 50, 60 };
+
+// content presented at a fixed frame rate, fed to the policy frame by
+// frame on a synthetic clock
+class Content {
+public:
+    Content(RefreshRatePolicy& policy, nsecs_t start = 0)
+        : mPolicy(policy),
+          mNow(start),
+          mSwitches(0)
+    {
+    }
+
+    // play frames at fps for ms, contentRate in 1/100 fps, 0 if static.
+    // Returns the rate switched to, 0 if none
+    uint32_t play(uint32_t contentRate, int cadence, uint32_t fps, uint32_t ms)
+    {
+        nsecs_t interval = s2ns(1) / fps;
+        nsecs_t end = mNow + ms2ns(ms);
+        uint32_t switched = 0;
+        for (; mNow < end; mNow += interval) {
+            uint32_t hz;
+            if (mPolicy.update(contentRate, cadence, mNow, hz)) {
+                switched = hz;
+                mSwitches++;
+            }
+        }
+        return switched;
+    }
+
+    nsecs_t now() const { return mNow; }
+    int switches() const { return mSwitches; }
+
+private:
+    RefreshRatePolicy& mPolicy;
+    nsecs_t mNow;
+    int mSwitches;
+};
+
+} // namespace
+
+TEST(RefreshRatePolicyTest, PickRate)
+{
+    const uint32_t *r = SORTED_RATES;
+    const int n = 4;
+    EXPECT_EQ(24u, RefreshRatePolicy::pickRate(r, n, 2400, CadenceTracker::CADENCE_24));
+    EXPECT_EQ(24u, RefreshRatePolicy::pickRate(r, n, 2397, CadenceTracker::CADENCE_PULLDOWN_32));
+    EXPECT_EQ(50u, RefreshRatePolicy::pickRate(r, n, 2500, CadenceTracker::CADENCE_25));
+    EXPECT_EQ(30u, RefreshRatePolicy::pickRate(r, n, 3000, CadenceTracker::CADENCE_30));
+    EXPECT_EQ(60u, RefreshRatePolicy::pickRate(r, n, 6000, CadenceTracker::CADENCE_60));
+    // measured rates without a cadence round to an integer fps count
+    EXPECT_EQ(30u, RefreshRatePolicy::pickRate(r, n, 1502, CadenceTracker::CADENCE_UNKNOWN));
+    EXPECT_EQ(30u, RefreshRatePolicy::pickRate(r, n, 1000, CadenceTracker::CADENCE_UNKNOWN));
+    EXPECT_EQ(50u, RefreshRatePolicy::pickRate(r, n, 2498, CadenceTracker::CADENCE_UNKNOWN));
+    // irregular and unmatched content gets the highest rate
+    EXPECT_EQ(60u, RefreshRatePolicy::pickRate(r, n, 4730, CadenceTracker::CADENCE_UNKNOWN));
+    EXPECT_EQ(60u, RefreshRatePolicy::pickRate(r, n, 7200, CadenceTracker::CADENCE_UNKNOWN));
+    // static content gets the lowest rate
+    EXPECT_EQ(24u, RefreshRatePolicy::pickRate(r, n, 0, CadenceTracker::CADENCE_UNKNOWN));
+    EXPECT_EQ((uint32_t)RefreshRatePolicy::RATE_NONE,
+              RefreshRatePolicy::pickRate(r, 0, 2400, CadenceTracker::CADENCE_24));
+}
+
+TEST(RefreshRatePolicyTest, SeededFromActiveMode)
+{
+    RefreshRatePolicy policy;
+    policy.setRates(TV_RATES, TV_RATE_COUNT, 60);
+    Content content(policy);
+    // UI animating at the rate of the active mode never switches
+    EXPECT_EQ(0u, content.play(6000, CadenceTracker::CADENCE_60, 60, 5000));
+    EXPECT_EQ(0, content.switches());
+}
+
+TEST(RefreshRatePolicyTest, FilmCadence)
+{
+    RefreshRatePolicy policy;
+    policy.setRates(TV_RATES, TV_RATE_COUNT, 60);
+    Content content(policy);
+    // a choice must hold for the hysteresis before it is applied
+    EXPECT_EQ(0u, content.play(2400, CadenceTracker::CADENCE_24, 24,
+                               RefreshRatePolicy::DEFAULT_HYSTERESIS_MS - 100));
+    EXPECT_EQ(24u, content.play(2400, CadenceTracker::CADENCE_24, 24, 200));
+    EXPECT_EQ(0u, content.play(2400, CadenceTracker::CADENCE_24, 24, 5000));
+    EXPECT_EQ(1, content.switches());
+
+    // PAL video goes to 50 Hz
+    EXPECT_EQ(0u, content.play(2500, CadenceTracker::CADENCE_25, 25, 900));
+    EXPECT_EQ(50u, content.play(2500, CadenceTracker::CADENCE_25, 25, 200));
+}
+
+TEST(RefreshRatePolicyTest, UnsteadyContentDoesNotSwitch)
+{
+    RefreshRatePolicy policy;
+    policy.setRates(TV_RATES, TV_RATE_COUNT, 60);
+    Content content(policy);
+    // the measured rate wanders between 24 and 30 fps, no choice holds
+    for (int i = 0; i < 10; i++) {
+        content.play(2400, CadenceTracker::CADENCE_24, 24, 600);
+        content.play(3000, CadenceTracker::CADENCE_30, 30, 600);
+    }
+    EXPECT_EQ(0, content.switches());
+}
+
+TEST(RefreshRatePolicyTest, StaticContentKeepsRate)
+{
+    RefreshRatePolicy policy;
+    policy.setRates(TV_RATES, TV_RATE_COUNT, 60);
+    Content content(policy);
+    // an idle UI stays at the active rate, touching it again does not
+    // switch either
+    EXPECT_EQ(0u, content.play(0, CadenceTracker::CADENCE_UNKNOWN, 2, 10000));
+    EXPECT_EQ(0u, content.play(6000, CadenceTracker::CADENCE_60, 60, 2000));
+    EXPECT_EQ(0, content.switches());
+
+    // film started from the idle UI still gets its rate
+    EXPECT_EQ(0u, content.play(0, CadenceTracker::CADENCE_UNKNOWN, 2, 5000));
+    EXPECT_EQ(24u, content.play(2400, CadenceTracker::CADENCE_24, 24, 1100));
+    EXPECT_EQ(0u, content.play(0, CadenceTracker::CADENCE_UNKNOWN, 2, 10000));
+    EXPECT_EQ(1, content.switches());
+}
+
+TEST(RefreshRatePolicyTest, StaticLowering)
+{
+    RefreshRatePolicy policy;
+    policy.setRates(TV_RATES, TV_RATE_COUNT, 60);
+    policy.setStaticLowering(true);
+    Content content(policy);
+    // static UI drops to the lowest rate after the longer static hold,
+    // frames still come in for a blinking cursor
+    EXPECT_EQ(0u, content.play(0, CadenceTracker::CADENCE_UNKNOWN, 2,
+                               RefreshRatePolicy::STATIC_HYSTERESIS_MS - 500));
+    EXPECT_EQ(24u, content.play(0, CadenceTracker::CADENCE_UNKNOWN, 2, 1000));
+
+    // a short scroll does not bring the rate back up
+    EXPECT_EQ(0u, content.play(6000, CadenceTracker::CADENCE_60, 60, 500));
+    EXPECT_EQ(0u, content.play(0, CadenceTracker::CADENCE_UNKNOWN, 2, 5000));
+    EXPECT_EQ(1, content.switches());
+
+    // moving content restores the rate after the normal hysteresis
+    EXPECT_EQ(60u, content.play(6000, CadenceTracker::CADENCE_60, 60, 1100));
+}
+
+TEST(RefreshRatePolicyTest, ModeChangedElsewhere)
+{
+    RefreshRatePolicy policy;
+    policy.setRates(TV_RATES, TV_RATE_COUNT, 60);
+    Content content(policy);
+    EXPECT_EQ(0u, content.play(6000, CadenceTracker::CADENCE_60, 60, 500));
+
+    // a video session has set 24 Hz, film content keeps it
+    policy.setRates(TV_RATES, TV_RATE_COUNT, 24);
+    EXPECT_EQ(0u, content.play(2400, CadenceTracker::CADENCE_24, 24, 5000));
+    EXPECT_EQ(0, content.switches());
+}
+
+TEST(RefreshRatePolicyTest, NoRates)
+{
+    RefreshRatePolicy policy;
+    EXPECT_FALSE(policy.hasRates());
+    Content content(policy);
+    EXPECT_EQ(0u, content.play(2400, CadenceTracker::CADENCE_24, 24, 5000));
+    EXPECT_EQ(0u, content.play(0, CadenceTracker::CADENCE_UNKNOWN, 2, 5000));
+
+    policy.setRates(TV_RATES, TV_RATE_COUNT, 60);
+    EXPECT_TRUE(policy.hasRates());
+    policy.reset();
+    EXPECT_FALSE(policy.hasRates());
+}
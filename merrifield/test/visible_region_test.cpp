@@ -0,0 +1,176 @@
+/*
+// Copyright (c) 2014 Intel Corporation 
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+#include <gtest/gtest.h>
+
+#include <string.h>
+
+#include <VisibleRegion.h>
+
+using namespace android::intel;
+
+namespace {
+
+hwc_rect_t rect(int left, int top, int right, int bottom)
+{
+    hwc_rect_t r = { left, top, right, bottom };
+    return r;
+}
+
+// pixel mask of a 64x64 area, the reference the region is checked against
+class Mask {
+public:
+    Mask() { memset(mPixels, 0, sizeof(mPixels)); }
+
+    void fill(const hwc_rect_t& r, bool value) {
+        for (int y = r.top; y < r.bottom; y++) {
+            for (int x = r.left; x < r.right; x++) {
+                mPixels[y][x] = value;
+            }
+        }
+    }
+
+    uint32_t count() const {
+        uint32_t n = 0;
+        for (int y = 0; y < SIZE; y++) {
+            for (int x = 0; x < SIZE; x++) {
+                n += mPixels[y][x] ? 1 : 0;
+            }
+        }
+        return n;
+    }
+
+    bool operator==(const Mask& rhs) const {
+        return memcmp(mPixels, rhs.mPixels, sizeof(mPixels)) == 0;
+    }
+
+    enum {
+        SIZE = 64,
+    };
+
+private:
+    bool mPixels[SIZE][SIZE];
+};
+
+Mask toMask(const VisibleRegion& region)
+{
+    Mask mask;
+    for (int i = 0; i < region.size(); i++) {
+        mask.fill(region.itemAt(i), true);
+    }
+    return mask;
+}
+
+} // namespace
+
+TEST(VisibleRegionTest, FullyCovered)
+{
+    VisibleRegion region;
+    region.set(rect(10, 10, 50, 50));
+    region.subtract(rect(0, 0, 64, 64));
+    EXPECT_TRUE(region.isEmpty());
+    EXPECT_EQ(0u, region.getArea());
+}
+
+TEST(VisibleRegionTest, CoveredByTwoOccluders)
+{
+    // neither occluder hides the layer alone
+    VisibleRegion region;
+    region.set(rect(0, 0, 40, 40));
+    region.subtract(rect(0, 0, 20, 40));
+    EXPECT_FALSE(region.isEmpty());
+    region.subtract(rect(20, 0, 40, 40));
+    EXPECT_TRUE(region.isEmpty());
+}
+
+TEST(VisibleRegionTest, CornerOccluder)
+{
+    // an occluder spanning neither the width nor the height
+    VisibleRegion region;
+    region.set(rect(0, 0, 40, 40));
+    region.subtract(rect(30, 30, 60, 60));
+    EXPECT_EQ(40u * 40u - 10u * 10u, region.getArea());
+    hwc_rect_t bounds = region.getBounds();
+    EXPECT_EQ(0, bounds.left);
+    EXPECT_EQ(0, bounds.top);
+    EXPECT_EQ(40, bounds.right);
+    EXPECT_EQ(40, bounds.bottom);
+}
+
+TEST(VisibleRegionTest, HoleInTheMiddle)
+{
+    VisibleRegion region;
+    region.set(rect(0, 0, 40, 40));
+    region.subtract(rect(10, 10, 30, 30));
+    EXPECT_EQ(40u * 40u - 20u * 20u, region.getArea());
+    EXPECT_EQ(4, region.size());
+}
+
+TEST(VisibleRegionTest, DisjointOccluder)
+{
+    VisibleRegion region;
+    region.set(rect(0, 0, 10, 10));
+    region.subtract(rect(10, 0, 20, 10));
+    region.subtract(rect(0, 0, 0, 0));
+    EXPECT_EQ(1, region.size());
+    EXPECT_EQ(100u, region.getArea());
+}
+
+TEST(VisibleRegionTest, MatchesPixelMask)
+{
+    uint32_t seed = 1;
+    for (int round = 0; round < 500; round++) {
+        seed = seed * 1103515245 + 12345;
+        int l = (seed >> 8) % 32;
+        int t = (seed >> 16) % 32;
+        hwc_rect_t layer = rect(l, t, l + 8 + (seed >> 4) % 24, t + 8 + (seed >> 12) % 24);
+
+        VisibleRegion region;
+        region.set(layer);
+        Mask expected;
+        expected.fill(layer, true);
+
+        for (int k = 0; k < 4; k++) {
+            seed = seed * 1103515245 + 12345;
+            int ol = (seed >> 8) % 56;
+            int ot = (seed >> 16) % 56;
+            hwc_rect_t o = rect(ol, ot, ol + 1 + (seed >> 4) % 8, ot + 1 + (seed >> 12) % 8);
+            region.subtract(o);
+            expected.fill(o, false);
+        }
+
+        ASSERT_FALSE(region.isInexact());
+        EXPECT_TRUE(toMask(region) == expected) << "round " << round;
+        // disjoint rectangles, so the area is the pixel count
+        EXPECT_EQ(expected.count(), region.getArea()) << "round " << round;
+    }
+}
+
+TEST(VisibleRegionTest, OverflowOverEstimates)
+{
+    VisibleRegion region;
+    region.set(rect(0, 0, 64, 64));
+    Mask hidden;
+    for (int y = 1; y < 64; y += 4) {
+        for (int x = 1; x < 64; x += 4) {
+            region.subtract(rect(x, y, x + 2, y + 2));
+            hidden.fill(rect(x, y, x + 2, y + 2), true);
+        }
+    }
+    EXPECT_TRUE(region.isInexact());
+    EXPECT_LE(region.size(), (int)VisibleRegion::MAX_RECTS);
+    // never less than what is really visible
+    EXPECT_GE(region.getArea(), 64u * 64u - hidden.count());
+}